@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// The # of bytes in a regular arena block
+// Larger allocations get a block of their own
+#define ARENA_BLOCK_CAPACITY 65536
+
+struct ArenaBlock {
+  ArenaBlock* pPrevious; // The block that was filled before this one
+  size_t length; // The # of bytes allocated from the block
+  size_t capacity; // The # of bytes the block can hold
+  char data[]; // The memory handed out by the block
+};
+
+// Initializes an empty arena
+void Arena_init(Arena* pArena) {
+  pArena->pBlock = NULL;
+  return;
+}
+
+// Allocates length bytes from the arena, with no alignment
+// The memory is valid until the arena is freed
+void* Arena_allocate(Arena* pArena, size_t length) {
+  ArenaBlock* pBlock = pArena->pBlock;
+
+  if (pBlock == NULL || pBlock->length + length > pBlock->capacity) {
+    size_t capacity = (length > ARENA_BLOCK_CAPACITY) ? length : ARENA_BLOCK_CAPACITY;
+
+    pBlock = malloc(sizeof(ArenaBlock) + capacity);
+    pBlock->pPrevious = pArena->pBlock;
+    pBlock->length = 0;
+    pBlock->capacity = capacity;
+    pArena->pBlock = pBlock;
+  }
+
+  void* pMemory = pBlock->data + pBlock->length;
+  pBlock->length += length;
+  return pMemory;
+}
+
+// Copies a string of length characters (plus its null terminator) into the arena
+char* Arena_copyString(Arena* pArena, const char* string, size_t length) {
+  char* copy = Arena_allocate(pArena, length + 1);
+
+  memcpy(copy, string, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+// Frees all memory allocated from the arena
+void Arena_free(Arena* pArena) {
+  ArenaBlock* pBlock = pArena->pBlock;
+
+  while (pBlock != NULL) {
+    ArenaBlock* pPrevious = pBlock->pPrevious;
+    free(pBlock);
+    pBlock = pPrevious;
+  }
+
+  pArena->pBlock = NULL;
+  return;
+}
@@ -0,0 +1,26 @@
+// Handles arena allocation
+#ifndef _ARENA_H_
+#define _ARENA_H_
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+// An allocator that hands out memory from large blocks, and frees all of it at once
+typedef struct {
+  ArenaBlock* pBlock; // The block currently being allocated from, linked to all previous blocks
+} Arena;
+
+// Initializes an empty arena
+void Arena_init(Arena* pArena);
+
+// Allocates length bytes from the arena, with no alignment
+// The memory is valid until the arena is freed
+void* Arena_allocate(Arena* pArena, size_t length);
+
+// Copies a string of length characters (plus its null terminator) into the arena
+char* Arena_copyString(Arena* pArena, const char* string, size_t length);
+
+// Frees all memory allocated from the arena
+void Arena_free(Arena* pArena);
+
+#endif
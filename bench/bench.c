@@ -0,0 +1,720 @@
+// Runs list over the generated benchmark trees and writes the results as JSON
+// Run as "bench [-r RUNS] [-o RESULTS] LIST TREE", where TREE was created by the generate program
+// Each case is timed with a warm page cache, and again with a cold one when caches can be dropped
+// The output of list is read through a pipe, so the time until its first byte arrives is measured as well
+// Cases for directories missing from the tree are skipped
+// The flat directories are also read twice with readdir, as list did before it read directories in a single pass,
+// to compare the # of getdents64 calls
+// Run as "bench -c LIST TREE" to check the system calls that list makes instead (make check)
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#endif
+
+// Set by fstatat and statx to stat the file descriptor itself, as fstat does
+#ifndef AT_EMPTY_PATH
+#define AT_EMPTY_PATH 0x1000
+#endif
+
+// The # of timed runs of each case, if not provided
+#define DEFAULT_RUNS_LENGTH 10
+
+// The most command line arguments given to list by a case, not counting the directory
+#define MAX_CASE_ARGUMENTS 4
+
+// The longest path built by the benchmark
+#define PATH_LENGTH 4096
+
+// The file that the page cache, dentries and inodes are dropped with
+#define DROP_CACHES_PATH "/proc/sys/vm/drop_caches"
+
+// The # of bytes of output read from list at a time
+#define READ_BUFFER_LENGTH 65536
+
+// A benchmarked command line
+typedef struct {
+  const char* name; // The name the results are reported under
+  const char* directory; // The directory in the tree that is listed
+  const char* arguments[MAX_CASE_ARGUMENTS + 1]; // The options given to list, terminated by NULL
+} BenchCase;
+
+// The measurements of a single run of list
+typedef struct {
+  long nanoseconds; // The wall time of the run
+  long firstByteNanoseconds; // The time until the first byte of output was read, or the wall time without output
+  long maxRssKilobytes; // The peak resident set size of the run
+} RunResult;
+
+// The system calls made by a run of list
+typedef struct {
+  long syscallsLength; // The # of system calls of every kind
+  long nameStatsLength; // The # of calls that stat a file by name, leaving out fstat calls on open file descriptors
+  long getdentsLength; // The # of calls that read directory entries
+} SyscallCounts;
+
+// A directory that the checks list with -R, to count the names it stats
+static const char* checkDirectories[] = {"wide", "deep"};
+
+// The flat directories whose getdents64 calls are compared with reading them twice
+static const char* flatDirectories[] = {"flat-10k", "flat-1m"};
+
+// Cases with --no-inode-order stat in name order, to compare with inode order when the cache is cold
+// Flat directories are generated in a scrambled order, so their name order does not follow their inode order
+static const BenchCase benchCases[] = {
+  {"flat-10k", "flat-10k", {NULL}},
+  {"flat-10k -l", "flat-10k", {"-l", NULL}},
+  {"flat-10k -i", "flat-10k", {"-i", NULL}},
+  {"flat-10k -li", "flat-10k", {"-li", NULL}},
+  {"flat-10k -U", "flat-10k", {"-U", NULL}},
+  {"flat-10k -l -j 4", "flat-10k", {"-l", "-j", "4", NULL}},
+  {"flat-10k -l --no-inode-order", "flat-10k", {"-l", "--no-inode-order", NULL}},
+  {"flat-1m", "flat-1m", {NULL}},
+  {"flat-1m -l", "flat-1m", {"-l", NULL}},
+  {"flat-1m -U", "flat-1m", {"-U", NULL}},
+  {"flat-1m -l -U", "flat-1m", {"-l", "-U", NULL}},
+  {"flat-1m -l -j 4", "flat-1m", {"-l", "-j", "4", NULL}},
+  {"flat-1m -l --no-inode-order", "flat-1m", {"-l", "--no-inode-order", NULL}},
+  {"deep -R", "deep", {"-R", NULL}},
+  {"deep -Rl", "deep", {"-Rl", NULL}},
+  {"wide -R", "wide", {"-R", NULL}},
+  {"wide -Rli", "wide", {"-Rli", NULL}},
+  {"wide -Rl -j 4", "wide", {"-Rl", "-j", "4", NULL}},
+  {"symlinks -l", "symlinks", {"-l", NULL}},
+  {"owners -l", "owners", {"-l", NULL}},
+  {"quoting", "quoting", {NULL}},
+  {"quoting -l", "quoting", {"-l", NULL}},
+};
+
+static void usageError() {
+  fprintf(stderr, "usage: bench [-c] [-r RUNS] [-o RESULTS] LIST TREE\n");
+  exit(1);
+  return;
+}
+
+static void runError(const char* listPath) {
+  fprintf(stderr, "bench: cannot run '%s'\n", listPath);
+  exit(1);
+  return;
+}
+
+// Reads the monotonic clock in nanoseconds
+static long getTime() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+// Discards the standard output of a child process, so the terminal is not part of the measurement
+static void discardOutput() {
+  int nullFd = open("/dev/null", O_WRONLY);
+
+  if (nullFd != -1) {
+    dup2(nullFd, STDOUT_FILENO);
+    close(nullFd);
+  }
+
+  return;
+}
+
+// Drops the page cache, dentries and inodes, so the next run reads everything from disk
+// Returns false if caches cannot be dropped, which needs root on Linux
+static bool dropCaches() {
+  sync();
+  int fd = open(DROP_CACHES_PATH, O_WRONLY);
+
+  if (fd == -1) {
+    return false;
+  }
+
+  bool isDropped = write(fd, "3", 1) == 1;
+  close(fd);
+  return isDropped;
+}
+
+// Runs list once with the provided arguments (terminated by NULL), and sets its wall time, time to first byte and
+// peak memory
+// The output is read from a pipe and discarded, and the first byte arrives when the first read returns data
+// Exits with an error if list cannot be run or fails
+static void runList(char** arguments, RunResult* pResult) {
+  static char buffer[READ_BUFFER_LENGTH];
+  int pipeFds[2];
+
+  if (pipe(pipeFds) == -1) {
+    runError(arguments[0]);
+  }
+
+  long startTime = getTime();
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    dup2(pipeFds[1], STDOUT_FILENO);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    execv(arguments[0], arguments);
+    _exit(127);
+  }
+
+  close(pipeFds[1]);
+  pResult->firstByteNanoseconds = -1;
+
+  while (pid != -1) {
+    ssize_t readLength = read(pipeFds[0], buffer, READ_BUFFER_LENGTH);
+
+    if (readLength == -1 && errno == EINTR) {
+      continue;
+    }
+
+    if (readLength <= 0) {
+      break;
+    }
+
+    if (pResult->firstByteNanoseconds == -1) {
+      pResult->firstByteNanoseconds = getTime() - startTime;
+    }
+  }
+
+  close(pipeFds[0]);
+
+  int status;
+  struct rusage usage;
+
+  if (pid == -1 || wait4(pid, &status, 0, &usage) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    runError(arguments[0]);
+  }
+
+  pResult->nanoseconds = getTime() - startTime;
+  pResult->maxRssKilobytes = usage.ru_maxrss;
+
+  if (pResult->firstByteNanoseconds == -1) {
+    pResult->firstByteNanoseconds = pResult->nanoseconds;
+  }
+
+  return;
+}
+
+#ifdef __linux__
+// Checks whether a system call stats a file by name, from its number and arguments
+// fstat is made with fstatat and AT_EMPTY_PATH, so those calls are left out
+static bool isNameStat(struct __ptrace_syscall_info* pInfo) {
+  long number = pInfo->entry.nr;
+
+#ifdef SYS_newfstatat
+  if (number == SYS_newfstatat) {
+    return (pInfo->entry.args[3] & AT_EMPTY_PATH) == 0;
+  }
+#endif
+#ifdef SYS_fstatat64
+  if (number == SYS_fstatat64) {
+    return (pInfo->entry.args[3] & AT_EMPTY_PATH) == 0;
+  }
+#endif
+#ifdef SYS_statx
+  if (number == SYS_statx) {
+    return (pInfo->entry.args[2] & AT_EMPTY_PATH) == 0;
+  }
+#endif
+#ifdef SYS_stat
+  if (number == SYS_stat) {
+    return true;
+  }
+#endif
+#ifdef SYS_lstat
+  if (number == SYS_lstat) {
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+// Checks whether a system call reads directory entries, from its number
+static bool isGetdents(struct __ptrace_syscall_info* pInfo) {
+#ifdef SYS_getdents64
+  if (pInfo->entry.nr == SYS_getdents64) {
+    return true;
+  }
+#endif
+#ifdef SYS_getdents
+  if (pInfo->entry.nr == SYS_getdents) {
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+// Counts the system calls made by all of the threads of a child process, until it exits
+// The child must have called PTRACE_TRACEME, and must stop before making the calls that are counted
+// Returns false if the process cannot be traced or does not exit successfully
+static bool traceSyscalls(pid_t pid, SyscallCounts* pCounts) {
+  int status;
+  if (pid == -1 || waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status)) {
+    return false;
+  }
+
+  long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL;
+  if (ptrace(PTRACE_SETOPTIONS, pid, NULL, (void*) options) == -1) {
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    return false;
+  }
+
+  pCounts->syscallsLength = 0;
+  pCounts->nameStatsLength = 0;
+  pCounts->getdentsLength = 0;
+  int tracedLength = 1;
+  bool isSuccess = false;
+  ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+  // Every thread started by list is traced as well, and reports its own stops
+  while (tracedLength > 0) {
+    pid_t tid = waitpid(-1, &status, __WALL);
+
+    if (tid == -1) {
+      break;
+    }
+
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      if (tid == pid) {
+        isSuccess = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      }
+      tracedLength--;
+      continue;
+    }
+
+    long signal = 0;
+
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      // Each system call stops once on entry and once on exit, and only entries are counted
+      struct __ptrace_syscall_info info;
+      if (ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void*) sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+        pCounts->syscallsLength++;
+        pCounts->nameStatsLength += isNameStat(&info);
+        pCounts->getdentsLength += isGetdents(&info);
+      }
+    } else if (status >> 16 == PTRACE_EVENT_CLONE) {
+      tracedLength++;
+    } else if (WSTOPSIG(status) != SIGTRAP && WSTOPSIG(status) != SIGSTOP) {
+      signal = WSTOPSIG(status);
+    }
+
+    ptrace(PTRACE_SYSCALL, tid, NULL, (void*) signal);
+  }
+
+  return isSuccess;
+}
+
+// Runs list once under ptrace and counts the system calls made by all of its threads
+// Returns false if the process cannot be traced
+static bool countSyscalls(char** arguments, SyscallCounts* pCounts) {
+  pid_t pid = fork();
+
+  // The child stops with SIGTRAP once it has been replaced by list
+  if (pid == 0) {
+    discardOutput();
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    execv(arguments[0], arguments);
+    _exit(127);
+  }
+
+  return traceSyscalls(pid, pCounts);
+}
+
+// Reads a directory twice with readdir under ptrace, counting the entries and then reading them again after
+// rewinddir, as list did before it read each directory in a single pass
+// Returns false if the process cannot be traced
+static bool countReadTwiceSyscalls(const char* directoryPath, SyscallCounts* pCounts) {
+  pid_t pid = fork();
+
+  // The child stops itself, so that only the calls made to read the directory are counted
+  if (pid == 0) {
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    raise(SIGSTOP);
+
+    DIR* directoryStream = opendir(directoryPath);
+    if (directoryStream == NULL) {
+      _exit(1);
+    }
+
+    while (readdir(directoryStream) != NULL);
+    rewinddir(directoryStream);
+    while (readdir(directoryStream) != NULL);
+
+    closedir(directoryStream);
+    _exit(0);
+  }
+
+  return traceSyscalls(pid, pCounts);
+}
+#else
+// System calls can only be counted with ptrace on Linux
+static bool countSyscalls(char** arguments, SyscallCounts* pCounts) {
+  return false;
+}
+
+static bool countReadTwiceSyscalls(const char* directoryPath, SyscallCounts* pCounts) {
+  return false;
+}
+#endif
+
+// Compares two times
+// Passed as an argument to qsort
+static int compareTimes(const void* pFirst, const void* pSecond) {
+  long first = *(const long*) pFirst;
+  long second = *(const long*) pSecond;
+
+  return (first > second) - (first < second);
+}
+
+// Gets the time at a percentile of runsLength sorted times, with the nearest rank method
+static long getPercentile(int runsLength, long* times, int percentile) {
+  int rank = (percentile * runsLength + 99) / 100;
+
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  return times[rank - 1];
+}
+
+// Writes a string as a JSON string, escaping quotes and backslashes
+static void writeJsonString(FILE* pFile, const char* string) {
+  fputc('"', pFile);
+
+  for (const char* pCharacter = string; *pCharacter != '\0'; pCharacter++) {
+    if (*pCharacter == '"' || *pCharacter == '\\') {
+      fputc('\\', pFile);
+    }
+    fputc(*pCharacter, pFile);
+  }
+
+  fputc('"', pFile);
+  return;
+}
+
+// Runs a case runsLength times and writes a JSON object with its timings, time to first byte and peak memory
+// With isCold set, caches are dropped before every run, and nothing is written if they cannot be
+// Returns false if the case was not run
+// pCounts is NULL if the system calls of list could not be counted
+static bool benchCase(FILE* pFile, const BenchCase* pCase, char** arguments, int runsLength, bool isCold, SyscallCounts* pCounts, bool isFirst) {
+  RunResult run;
+  long* times = malloc(sizeof(long) * runsLength);
+  long* firstByteTimes = malloc(sizeof(long) * runsLength);
+  long totalNanoseconds = 0;
+  long maxRssKilobytes = 0;
+
+  // A warm run first fills the caches, and is not measured
+  if (!isCold) {
+    runList(arguments, &run);
+  }
+
+  for (int i = 0; i < runsLength; i++) {
+    if (isCold && !dropCaches()) {
+      free(times);
+      free(firstByteTimes);
+      return false;
+    }
+
+    runList(arguments, &run);
+    times[i] = run.nanoseconds;
+    firstByteTimes[i] = run.firstByteNanoseconds;
+    totalNanoseconds += run.nanoseconds;
+
+    if (run.maxRssKilobytes > maxRssKilobytes) {
+      maxRssKilobytes = run.maxRssKilobytes;
+    }
+  }
+
+  qsort(times, runsLength, sizeof(long), compareTimes);
+  qsort(firstByteTimes, runsLength, sizeof(long), compareTimes);
+
+  fprintf(pFile, "%s\n    {\"name\": ", isFirst ? "" : ",");
+  writeJsonString(pFile, pCase->name);
+  fprintf(pFile, ", \"cache\": \"%s\", \"arguments\": [", isCold ? "cold" : "warm");
+
+  // The path of list is left out, so results from different builds can be compared
+  for (int i = 1; arguments[i] != NULL; i++) {
+    fprintf(pFile, "%s", (i == 1) ? "" : ", ");
+    writeJsonString(pFile, arguments[i]);
+  }
+
+  fprintf(pFile, "], \"runs\": %d", runsLength);
+  fprintf(pFile, ", \"min_ns\": %ld, \"p50_ns\": %ld", times[0], getPercentile(runsLength, times, 50));
+  fprintf(pFile, ", \"p90_ns\": %ld, \"p99_ns\": %ld", getPercentile(runsLength, times, 90), getPercentile(runsLength, times, 99));
+  fprintf(pFile, ", \"max_ns\": %ld, \"mean_ns\": %ld", times[runsLength - 1], totalNanoseconds / runsLength);
+  fprintf(pFile, ", \"first_byte_p50_ns\": %ld", getPercentile(runsLength, firstByteTimes, 50));
+  fprintf(pFile, ", \"first_byte_p99_ns\": %ld", getPercentile(runsLength, firstByteTimes, 99));
+  fprintf(pFile, ", \"max_rss_kb\": %ld, \"syscalls\": ", maxRssKilobytes);
+
+  if (pCounts == NULL) {
+    fprintf(pFile, "null, \"name_stats\": null, \"getdents\": null}");
+  } else {
+    fprintf(pFile, "%ld, \"name_stats\": %ld, \"getdents\": %ld}", pCounts->syscallsLength, pCounts->nameStatsLength,
+      pCounts->getdentsLength);
+  }
+
+  fprintf(stderr, "bench: %-16s %s  p50 %8.3f ms  p99 %8.3f ms  first byte %8.3f ms  rss %6ld kB\n", pCase->name,
+    isCold ? "cold" : "warm", getPercentile(runsLength, times, 50) / 1e6, getPercentile(runsLength, times, 99) / 1e6,
+    getPercentile(runsLength, firstByteTimes, 50) / 1e6, maxRssKilobytes);
+
+  free(times);
+  free(firstByteTimes);
+  return true;
+}
+
+// Counts the visible entries of a directory and all of its subdirectories, as list -R lists them
+// Also counts the entries whose file type the directory does not provide, which list must stat to find
+// Each directory is closed before its subdirectories are counted, so deep trees do not run out of file descriptors
+static void countEntries(const char* directoryPath, long* pEntriesLength, long* pUnknownLength) {
+  DIR* directoryStream = opendir(directoryPath);
+
+  if (directoryStream == NULL) {
+    return;
+  }
+
+  int subdirectoriesLength = 0;
+  char (*subdirectories)[NAME_MAX + 1] = NULL;
+  struct dirent* pDirectoryEntry;
+
+  while ((pDirectoryEntry = readdir(directoryStream)) != NULL) {
+    if (pDirectoryEntry->d_name[0] == '.') {
+      continue;
+    }
+
+    (*pEntriesLength)++;
+    bool isDirectory = pDirectoryEntry->d_type == DT_DIR;
+
+    if (pDirectoryEntry->d_type == DT_UNKNOWN) {
+      char path[PATH_LENGTH];
+      struct stat statBuffer;
+
+      (*pUnknownLength)++;
+      snprintf(path, PATH_LENGTH, "%s/%s", directoryPath, pDirectoryEntry->d_name);
+      isDirectory = lstat(path, &statBuffer) == 0 && S_ISDIR(statBuffer.st_mode);
+    }
+
+    if (isDirectory) {
+      subdirectories = realloc(subdirectories, (NAME_MAX + 1) * (size_t) (subdirectoriesLength + 1));
+      strcpy(subdirectories[subdirectoriesLength], pDirectoryEntry->d_name);
+      subdirectoriesLength++;
+    }
+  }
+
+  closedir(directoryStream);
+
+  for (int i = 0; i < subdirectoriesLength; i++) {
+    char path[PATH_LENGTH];
+    snprintf(path, PATH_LENGTH, "%s/%s", directoryPath, subdirectories[i]);
+    countEntries(path, pEntriesLength, pUnknownLength);
+  }
+
+  free(subdirectories);
+  return;
+}
+
+// Checks the system calls that list makes for directories of the tree
+// list -R only needs the type of each entry, which it takes from the directory, so it may only stat the entries of
+// unknown type by name (and the directory it is given). list -Rl must stat every entry, which shows they are counted
+// Returns false if a check fails, and true if every check passes or system calls cannot be counted
+static bool checkSyscalls(char* listPath, char* treePath) {
+  bool isPassed = true;
+
+  for (size_t i = 0; i < sizeof(checkDirectories) / sizeof(char*); i++) {
+    char directoryPath[PATH_LENGTH];
+    long entriesLength = 0;
+    long unknownLength = 0;
+    SyscallCounts counts;
+    SyscallCounts longCounts;
+
+    snprintf(directoryPath, PATH_LENGTH, "%s/%s", treePath, checkDirectories[i]);
+    countEntries(directoryPath, &entriesLength, &unknownLength);
+
+    char* arguments[] = {listPath, "-R", directoryPath, NULL};
+    char* longArguments[] = {listPath, "-Rl", directoryPath, NULL};
+
+    if (!countSyscalls(arguments, &counts) || !countSyscalls(longArguments, &longCounts)) {
+      fprintf(stderr, "bench: cannot trace '%s', so its system calls are not checked\n", listPath);
+      return true;
+    }
+
+    bool isStatsPassed = counts.nameStatsLength <= unknownLength + 1 && longCounts.nameStatsLength >= entriesLength;
+    fprintf(stderr, "bench: %-8s %ld entries, %ld of unknown type  -R stats %ld names  -Rl stats %ld names  %s\n",
+      checkDirectories[i], entriesLength, unknownLength, counts.nameStatsLength, longCounts.nameStatsLength,
+      isStatsPassed ? "ok" : "FAILED");
+    isPassed = isPassed && isStatsPassed;
+  }
+
+  // A single pass over a flat directory makes half the getdents64 calls of reading it twice
+  char directoryPath[PATH_LENGTH];
+  snprintf(directoryPath, PATH_LENGTH, "%s/%s", treePath, flatDirectories[0]);
+
+  char* arguments[] = {listPath, directoryPath, NULL};
+  SyscallCounts counts;
+  SyscallCounts readTwiceCounts;
+
+  if (!countSyscalls(arguments, &counts) || !countReadTwiceSyscalls(directoryPath, &readTwiceCounts)) {
+    fprintf(stderr, "bench: cannot trace '%s', so its system calls are not checked\n", listPath);
+    return true;
+  }
+
+  bool isGetdentsPassed = counts.getdentsLength * 2 <= readTwiceCounts.getdentsLength;
+  fprintf(stderr, "bench: %-8s getdents64 calls  list %ld  read twice %ld  %s\n", flatDirectories[0],
+    counts.getdentsLength, readTwiceCounts.getdentsLength, isGetdentsPassed ? "ok" : "FAILED");
+
+  return isPassed && isGetdentsPassed;
+}
+
+// Writes the # of getdents64 calls made by reading each flat directory twice, as list did before it read
+// directories in a single pass, to compare with the calls made by the cases that list them
+static void writeReadTwiceResults(FILE* pFile, char* treePath) {
+  fprintf(pFile, ",\n  \"read_twice\": [");
+  bool isFirst = true;
+
+  for (size_t i = 0; i < sizeof(flatDirectories) / sizeof(char*); i++) {
+    char directoryPath[PATH_LENGTH];
+    struct stat statBuffer;
+    SyscallCounts counts;
+
+    snprintf(directoryPath, PATH_LENGTH, "%s/%s", treePath, flatDirectories[i]);
+
+    if (stat(directoryPath, &statBuffer) == -1 || !countReadTwiceSyscalls(directoryPath, &counts)) {
+      continue;
+    }
+
+    fprintf(pFile, "%s\n    {\"directory\": ", isFirst ? "" : ",");
+    writeJsonString(pFile, flatDirectories[i]);
+    fprintf(pFile, ", \"getdents\": %ld}", counts.getdentsLength);
+    fprintf(stderr, "bench: %-16s getdents64 calls when read twice %ld\n", flatDirectories[i], counts.getdentsLength);
+    isFirst = false;
+  }
+
+  fprintf(pFile, "\n  ]");
+  return;
+}
+
+int main(int argc, char* argv[]) {
+  int runsLength = DEFAULT_RUNS_LENGTH;
+  char* resultsPath = NULL;
+  bool isCheck = false;
+  int argumentIndex = 1;
+
+  while (argumentIndex < argc && argv[argumentIndex][0] == '-') {
+    if (strcmp(argv[argumentIndex], "-c") == 0) {
+      isCheck = true;
+      argumentIndex++;
+      continue;
+    }
+
+    if (argumentIndex + 1 >= argc) {
+      usageError();
+    }
+
+    if (strcmp(argv[argumentIndex], "-r") == 0) {
+      runsLength = atoi(argv[argumentIndex + 1]);
+    } else if (strcmp(argv[argumentIndex], "-o") == 0) {
+      resultsPath = argv[argumentIndex + 1];
+    } else {
+      usageError();
+    }
+
+    argumentIndex += 2;
+  }
+
+  if (argumentIndex != argc - 2 || runsLength < 1) {
+    usageError();
+  }
+
+  char* listPath = argv[argumentIndex];
+  char* treePath = argv[argumentIndex + 1];
+  FILE* pFile = stdout;
+
+  if (isCheck) {
+    return checkSyscalls(listPath, treePath) ? 0 : 1;
+  }
+
+  if (resultsPath != NULL) {
+    pFile = fopen(resultsPath, "w");
+
+    if (pFile == NULL) {
+      fprintf(stderr, "bench: cannot write '%s'\n", resultsPath);
+      exit(1);
+    }
+  }
+
+  struct utsname systemName;
+  uname(&systemName);
+
+  fprintf(pFile, "{\n  \"list\": ");
+  writeJsonString(pFile, listPath);
+  fprintf(pFile, ",\n  \"system\": ");
+  writeJsonString(pFile, systemName.sysname);
+  fprintf(pFile, ",\n  \"release\": ");
+  writeJsonString(pFile, systemName.release);
+  fprintf(pFile, ",\n  \"machine\": ");
+  writeJsonString(pFile, systemName.machine);
+  fprintf(pFile, ",\n  \"timestamp\": %ld,\n  \"results\": [", (long) time(NULL));
+
+  bool isFirst = true;
+  bool canDropCaches = true;
+
+  for (size_t i = 0; i < sizeof(benchCases) / sizeof(BenchCase); i++) {
+    const BenchCase* pCase = &benchCases[i];
+    char directoryPath[PATH_LENGTH];
+    struct stat statBuffer;
+
+    snprintf(directoryPath, PATH_LENGTH, "%s/%s", treePath, pCase->directory);
+
+    if (stat(directoryPath, &statBuffer) == -1) {
+      continue;
+    }
+
+    // The command line is list, the case options, then the listed directory
+    char* arguments[MAX_CASE_ARGUMENTS + 3];
+    int argumentsLength = 0;
+
+    arguments[argumentsLength++] = listPath;
+    for (int j = 0; pCase->arguments[j] != NULL; j++) {
+      arguments[argumentsLength++] = (char*) pCase->arguments[j];
+    }
+    arguments[argumentsLength++] = directoryPath;
+    arguments[argumentsLength] = NULL;
+
+    SyscallCounts counts;
+    SyscallCounts* pCounts = countSyscalls(arguments, &counts) ? &counts : NULL;
+
+    benchCase(pFile, pCase, arguments, runsLength, false, pCounts, isFirst);
+    isFirst = false;
+
+    if (canDropCaches && !benchCase(pFile, pCase, arguments, runsLength, true, pCounts, isFirst)) {
+      fprintf(stderr, "bench: cannot drop caches, so only warm runs are measured\n");
+      canDropCaches = false;
+    }
+  }
+
+  fprintf(pFile, "\n  ]");
+  writeReadTwiceResults(pFile, treePath);
+  fprintf(pFile, "\n}\n");
+
+  if (pFile != stdout) {
+    fclose(pFile);
+  }
+
+  return 0;
+}
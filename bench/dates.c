@@ -0,0 +1,130 @@
+// Compares Helpers_parseDate with formatting every timestamp with localtime_r and strftime
+// Run as "dates [-n TIMESTAMPS]" with TZ set to the time zone to check
+// Every formatted date is checked against strftime, and the time per date is reported for each pattern
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../helpers.h"
+
+// The # of timestamps in each pattern, if not provided
+#define DEFAULT_TIMESTAMPS_LENGTH 4000000
+
+// The # of days that the files of a directory are spread over in the "directory" pattern
+#define DIRECTORY_DAYS_LENGTH 6
+
+// The first timestamp of every pattern, which is in 2023
+#define FIRST_TIMESTAMP 1672531200
+
+// The ways that timestamps are generated, from mostly cached to mostly uncached
+typedef enum {
+  PATTERN_WALK, // Each timestamp is a few minutes after or before the previous one, crossing DST changes
+  PATTERN_DIRECTORY, // Timestamps are scattered over a few days, like the files of a directory
+  PATTERN_SPREAD // Timestamps are scattered over 10 years, so almost every day differs
+} Pattern;
+
+static const char* patternNames[] = {"walk", "directory", "spread"};
+
+static void usageError() {
+  fprintf(stderr, "usage: dates [-n TIMESTAMPS]\n");
+  exit(1);
+  return;
+}
+
+// Reads the monotonic clock in nanoseconds
+static long getTime() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+// Gets the next number from a xorshift generator, so every run uses the same timestamps
+static uint64_t getRandom(uint64_t* pState) {
+  *pState ^= *pState << 13;
+  *pState ^= *pState >> 7;
+  *pState ^= *pState << 17;
+  return *pState;
+}
+
+// Fills an array with timestamps following a pattern
+static void generateTimestamps(Pattern pattern, int timestampsLength, time_t* timestamps) {
+  uint64_t state = 88172645463325252ull;
+  time_t timestamp = FIRST_TIMESTAMP;
+
+  for (int i = 0; i < timestampsLength; i++) {
+    switch (pattern) {
+      case PATTERN_WALK:
+        timestamp += (long) (getRandom(&state) % 1200) - 500;
+        timestamps[i] = timestamp;
+        break;
+      case PATTERN_DIRECTORY:
+        timestamps[i] = FIRST_TIMESTAMP + (getRandom(&state) % (DIRECTORY_DAYS_LENGTH * 86400L));
+        break;
+      case PATTERN_SPREAD:
+        timestamps[i] = FIRST_TIMESTAMP + (getRandom(&state) % (3650 * 86400L));
+        break;
+    }
+  }
+
+  return;
+}
+
+int main(int argc, char* argv[]) {
+  int timestampsLength = DEFAULT_TIMESTAMPS_LENGTH;
+
+  if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+    timestampsLength = atoi(argv[2]);
+  } else if (argc != 1) {
+    usageError();
+  }
+
+  if (timestampsLength < 1) {
+    usageError();
+  }
+
+  tzset();
+  time_t* timestamps = malloc(sizeof(time_t) * timestampsLength);
+  char (*expectedDates)[DATE_STRING_LENGTH] = malloc(DATE_STRING_LENGTH * (size_t) timestampsLength);
+  char (*dates)[DATE_STRING_LENGTH] = malloc(DATE_STRING_LENGTH * (size_t) timestampsLength);
+  long mismatchesLength = 0;
+  const char* timeZone = getenv("TZ");
+
+  for (int pattern = PATTERN_WALK; pattern <= PATTERN_SPREAD; pattern++) {
+    generateTimestamps(pattern, timestampsLength, timestamps);
+
+    // Time the per-call path that Helpers_parseDate replaces, keeping its results to compare with
+    long startTime = getTime();
+    for (int i = 0; i < timestampsLength; i++) {
+      struct tm time;
+      localtime_r(&timestamps[i], &time);
+      strftime(expectedDates[i], DATE_STRING_LENGTH, "%b %e %Y %H:%M", &time);
+    }
+    long strftimeTime = getTime() - startTime;
+
+    startTime = getTime();
+    for (int i = 0; i < timestampsLength; i++) {
+      Helpers_parseDate(timestamps[i], dates[i]);
+    }
+    long parseDateTime = getTime() - startTime;
+
+    for (int i = 0; i < timestampsLength; i++) {
+      mismatchesLength += strcmp(dates[i], expectedDates[i]) != 0;
+    }
+
+    printf("dates: %-9s %-20s strftime %7.1f ns  parseDate %7.1f ns\n", patternNames[pattern], timeZone == NULL ? "(local)" : timeZone,
+      (double) strftimeTime / timestampsLength, (double) parseDateTime / timestampsLength);
+  }
+
+  free(timestamps);
+  free(expectedDates);
+  free(dates);
+
+  if (mismatchesLength > 0) {
+    fprintf(stderr, "dates: %ld dates differ from strftime\n", mismatchesLength);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,326 @@
+// Generates the synthetic directory trees used by the benchmarks
+// Run as "generate [-L] DIRECTORY", where -L also generates a flat directory with a million entries
+// A tree that has already been generated is left as it is
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The file created once a tree is complete, hidden so that it is never listed
+#define COMPLETE_FILENAME ".complete"
+
+// The # of entries in the small and large flat directories
+#define SMALL_FLAT_LENGTH 10000
+#define LARGE_FLAT_LENGTH 1000000
+
+// The # of nested directories in the deep chain, and the # of files in each of them
+// The chain is deeper than the # of directories -R keeps open, so closed directories are opened again
+#define DEEP_DEPTH 1000
+#define DEEP_FILES_LENGTH 4
+
+// The # of subdirectories at each of the two levels of the wide tree, and the # of files in each leaf
+#define WIDE_FANOUT 64
+#define WIDE_FILES_LENGTH 8
+
+// The # of symbolic links, and the # of files they point to
+#define SYMLINKS_LENGTH 10000
+#define SYMLINK_TARGETS_LENGTH 100
+
+// The # of files with different owners, and the # of distinct user and group IDs they are given
+#define OWNERS_FILES_LENGTH 10000
+#define OWNERS_IDS_LENGTH 256
+#define OWNERS_FIRST_ID 20000
+
+// The # of files with names that must be quoted
+#define QUOTING_LENGTH 10000
+
+// The longest name or path built by the generator
+#define NAME_LENGTH 64
+
+// The longest name that file systems allow, which the names checked by make check go up to
+#define MAX_NAME_LENGTH 255
+
+// The characters that decide how names are quoted, the same as the ones checked by printFilename
+#define QUOTING_CHARACTERS " !$^&()'`\""
+
+static void usageError() {
+  fprintf(stderr, "usage: generate [-L] DIRECTORY\n");
+  exit(1);
+  return;
+}
+
+static void createError(const char* name) {
+  fprintf(stderr, "generate: cannot create '%s': %s\n", name, strerror(errno));
+  exit(1);
+  return;
+}
+
+// Creates a directory relative to parentFd and opens it
+// Exits with an error if the directory cannot be created or opened
+static int createDirectory(int parentFd, const char* name) {
+  if (mkdirat(parentFd, name, 0755) == -1 && errno != EEXIST) {
+    createError(name);
+  }
+
+  int directoryFd = openat(parentFd, name, O_RDONLY | O_DIRECTORY);
+
+  if (directoryFd == -1) {
+    createError(name);
+  }
+
+  return directoryFd;
+}
+
+// Creates an empty file relative to directoryFd, with size bytes of unwritten data
+static void createFile(int directoryFd, const char* name, off_t size) {
+  int fileFd = openat(directoryFd, name, O_WRONLY | O_CREAT, 0644);
+
+  if (fileFd == -1) {
+    createError(name);
+  }
+
+  if (size > 0 && ftruncate(fileFd, size) == -1) {
+    createError(name);
+  }
+
+  close(fileFd);
+  return;
+}
+
+// Creates a directory of length empty files with numbered names
+// The names are created in a scrambled order, so directory order does not match sorted order
+static void generateFlat(int rootFd, const char* name, int length) {
+  int directoryFd = createDirectory(rootFd, name);
+  char filename[NAME_LENGTH];
+
+  for (int i = 0; i < length; i++) {
+    int number = (int) (((long) i * 7919) % length);
+    snprintf(filename, NAME_LENGTH, "file%07d", number);
+    createFile(directoryFd, filename, number % 4096);
+  }
+
+  close(directoryFd);
+  return;
+}
+
+// Creates a chain of nested directories, each holding a few files and the next directory
+static void generateDeep(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "deep");
+  char filename[NAME_LENGTH];
+
+  for (int depth = 0; depth < DEEP_DEPTH; depth++) {
+    for (int i = 0; i < DEEP_FILES_LENGTH; i++) {
+      snprintf(filename, NAME_LENGTH, "file%d", i);
+      createFile(directoryFd, filename, depth);
+    }
+
+    int childFd = createDirectory(directoryFd, "d");
+    close(directoryFd);
+    directoryFd = childFd;
+  }
+
+  close(directoryFd);
+  return;
+}
+
+// Creates two levels of many subdirectories, with a few files in each leaf directory
+static void generateWide(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "wide");
+  char filename[NAME_LENGTH];
+
+  for (int i = 0; i < WIDE_FANOUT; i++) {
+    snprintf(filename, NAME_LENGTH, "branch%02d", i);
+    int branchFd = createDirectory(directoryFd, filename);
+
+    for (int j = 0; j < WIDE_FANOUT; j++) {
+      snprintf(filename, NAME_LENGTH, "leaf%02d", j);
+      int leafFd = createDirectory(branchFd, filename);
+
+      for (int k = 0; k < WIDE_FILES_LENGTH; k++) {
+        snprintf(filename, NAME_LENGTH, "file%d", k);
+        createFile(leafFd, filename, k * 100);
+      }
+
+      close(leafFd);
+    }
+
+    close(branchFd);
+  }
+
+  close(directoryFd);
+  return;
+}
+
+// Creates a directory of symbolic links to a smaller set of files
+// Every tenth link points to a missing file
+static void generateSymlinks(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "symlinks");
+  char filename[NAME_LENGTH];
+  char target[NAME_LENGTH];
+
+  for (int i = 0; i < SYMLINK_TARGETS_LENGTH; i++) {
+    snprintf(filename, NAME_LENGTH, "target%03d", i);
+    createFile(directoryFd, filename, i);
+  }
+
+  for (int i = 0; i < SYMLINKS_LENGTH; i++) {
+    snprintf(filename, NAME_LENGTH, "link%05d", i);
+
+    if (i % 10 == 0) {
+      snprintf(target, NAME_LENGTH, "missing%05d", i);
+    } else {
+      snprintf(target, NAME_LENGTH, "target%03d", i % SYMLINK_TARGETS_LENGTH);
+    }
+
+    if (symlinkat(target, directoryFd, filename) == -1 && errno != EEXIST) {
+      createError(filename);
+    }
+  }
+
+  close(directoryFd);
+  return;
+}
+
+// Creates a directory of files owned by many different users and groups
+// The IDs have no names, so every one of them is looked up and missed
+// Returns false if the owners could not be changed, which needs root
+static bool generateOwners(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "owners");
+  char filename[NAME_LENGTH];
+  bool isOwned = true;
+
+  for (int i = 0; i < OWNERS_FILES_LENGTH; i++) {
+    snprintf(filename, NAME_LENGTH, "file%05d", i);
+    createFile(directoryFd, filename, i);
+
+    uid_t uid = OWNERS_FIRST_ID + i % OWNERS_IDS_LENGTH;
+    gid_t gid = OWNERS_FIRST_ID + (i / OWNERS_IDS_LENGTH) % OWNERS_IDS_LENGTH;
+
+    if (isOwned && fchownat(directoryFd, filename, uid, gid, AT_SYMLINK_NOFOLLOW) == -1) {
+      isOwned = false;
+    }
+  }
+
+  close(directoryFd);
+  return isOwned;
+}
+
+// Creates a directory of files with names that are printed with quotes
+// Each name contains one of the special characters checked by printFilename
+static void generateQuoting(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "quoting");
+  const char* specialCharacters = QUOTING_CHARACTERS;
+  int specialLength = strlen(specialCharacters);
+  char filename[NAME_LENGTH];
+
+  for (int i = 0; i < QUOTING_LENGTH; i++) {
+    snprintf(filename, NAME_LENGTH, "file%c%05d name", specialCharacters[i % specialLength], i);
+    createFile(directoryFd, filename, i);
+  }
+
+  close(directoryFd);
+  return;
+}
+
+// Creates a directory of files with names of every length from 1 to 255 characters
+// Names of each length have no special characters, or one of the special characters at their start, middle or end,
+// or a special character at their start and a single quote at their end
+// Each length crosses the 16 and 32 character blocks of the vector scans at a different point (make check)
+static void generateQuotingLengths(int rootFd) {
+  int directoryFd = createDirectory(rootFd, "quoting-lengths");
+  const char* specialCharacters = QUOTING_CHARACTERS;
+  int specialLength = strlen(specialCharacters);
+  char filename[MAX_NAME_LENGTH + 1];
+
+  for (int length = 1; length <= MAX_NAME_LENGTH; length++) {
+    for (int i = 0; i < length; i++) {
+      filename[i] = 'a' + (length + i) % 26;
+    }
+    filename[length] = '\0';
+    createFile(directoryFd, filename, 0);
+
+    // Short names are created more than once when the positions overlap, which leaves a single file
+    int positions[] = {0, length / 2, length - 1};
+
+    for (int j = 0; j < specialLength; j++) {
+      for (int k = 0; k < 3; k++) {
+        char replaced = filename[positions[k]];
+        filename[positions[k]] = specialCharacters[j];
+        createFile(directoryFd, filename, 0);
+        filename[positions[k]] = replaced;
+      }
+
+      if (length > 1) {
+        char first = filename[0];
+        char last = filename[length - 1];
+        filename[0] = specialCharacters[j];
+        filename[length - 1] = '\'';
+        createFile(directoryFd, filename, 0);
+        filename[0] = first;
+        filename[length - 1] = last;
+      }
+    }
+  }
+
+  close(directoryFd);
+  return;
+}
+
+int main(int argc, char* argv[]) {
+  bool isLarge = false;
+  int argumentIndex = 1;
+
+  if (argumentIndex < argc && strcmp(argv[argumentIndex], "-L") == 0) {
+    isLarge = true;
+    argumentIndex++;
+  }
+
+  if (argumentIndex != argc - 1) {
+    usageError();
+  }
+
+  char* rootPath = argv[argumentIndex];
+  int rootFd = createDirectory(AT_FDCWD, rootPath);
+  struct stat statBuffer;
+
+  // The large directory can be added to a tree that was generated without it
+  bool isComplete = fstatat(rootFd, COMPLETE_FILENAME, &statBuffer, 0) == 0;
+  bool hasLarge = fstatat(rootFd, "flat-1m/" COMPLETE_FILENAME, &statBuffer, 0) == 0;
+  bool hasQuotingLengths = fstatat(rootFd, "quoting-lengths/" COMPLETE_FILENAME, &statBuffer, 0) == 0;
+
+  if (!isComplete) {
+    printf("generate: creating trees in '%s'\n", rootPath);
+    generateFlat(rootFd, "flat-10k", SMALL_FLAT_LENGTH);
+    generateDeep(rootFd);
+    generateWide(rootFd);
+    generateSymlinks(rootFd);
+
+    if (!generateOwners(rootFd)) {
+      fprintf(stderr, "generate: cannot change file owners, so 'owners' has a single owner\n");
+    }
+
+    generateQuoting(rootFd);
+    createFile(rootFd, COMPLETE_FILENAME, 0);
+  }
+
+  // The names checked by make check can be added to a tree that was generated without them
+  if (!hasQuotingLengths) {
+    generateQuotingLengths(rootFd);
+    createFile(rootFd, "quoting-lengths/" COMPLETE_FILENAME, 0);
+  }
+
+  if (isLarge && !hasLarge) {
+    printf("generate: creating a directory of %d entries in '%s'\n", LARGE_FLAT_LENGTH, rootPath);
+    generateFlat(rootFd, "flat-1m", LARGE_FLAT_LENGTH);
+    createFile(rootFd, "flat-1m/" COMPLETE_FILENAME, 0);
+  }
+
+  close(rootFd);
+  return 0;
+}
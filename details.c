@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "details.h"
+#include "helpers.h"
+#include "quoting.h"
+#include "record.h"
+
+// Checks whether only the file type of entries is needed, which the directory entries usually provide
+// Every other option that prints or sorts by metadata needs each entry to be statted
+bool Details_isTypeOnly(Options* pOptions) {
+  return !pOptions->longOption && !pOptions->indexOption && pOptions->format == FORMAT_TEXT && pOptions->sortOrder == SORT_NAME && !pOptions->usageOption;
+}
+
+// Gets information about a group of files and sets a struct with this info
+// Reads the metadata already recorded in each entry, so no files are accessed
+// Sets the quoting flags of every entry
+// Widths are only computed for the columns enabled by the options
+// Records printed with the --format option are not padded, so no widths are computed for them
+void Details_getGroupInfo(int entriesLength, FileEntry* entries, Options* pOptions, FileGroupInfo* pFileGroupInfo) {
+  if (pOptions->format != FORMAT_TEXT) {
+    memset(pFileGroupInfo, 0, sizeof(FileGroupInfo));
+    return;
+  }
+
+  long maxId = 0;
+  long maxLinks = 0;
+  long maxSize = 0;
+  int maxUserLetters = 0;
+  int maxGroupLetters = 0;
+  bool hasSpecialCharacters = false;
+
+  for (int i = 0; i < entriesLength; i++) {
+    struct stat* pStatBuffer = &entries[i].statBuffer;
+
+    // The name is scanned once here, and its flags decide how it is quoted when printed
+    entries[i].quoting = Quoting_classifyName(entries[i].name, entries[i].nameLength);
+
+    if (entries[i].quoting != 0) {
+      hasSpecialCharacters = true;
+    }
+
+    if (pOptions->indexOption && pStatBuffer->st_ino > maxId) {
+      maxId = pStatBuffer->st_ino;
+    }
+
+    if (!pOptions->longOption) {
+      continue;
+    }
+
+    if (pStatBuffer->st_nlink > maxLinks) {
+      maxLinks = pStatBuffer->st_nlink;
+    }
+
+    if (pStatBuffer->st_size > maxSize) {
+      maxSize = pStatBuffer->st_size;
+    }
+
+    int userNameLength;
+    Helpers_getUserName(pStatBuffer->st_uid, &userNameLength);
+    if (userNameLength > maxUserLetters) {
+      maxUserLetters = userNameLength;
+    }
+
+    int groupNameLength;
+    Helpers_getGroupName(pStatBuffer->st_gid, &groupNameLength);
+    if (groupNameLength > maxGroupLetters) {
+      maxGroupLetters = groupNameLength;
+    }
+  }
+
+  if (maxId == 0) {
+    pFileGroupInfo->maxIdDigits = 1;
+  } else {
+    pFileGroupInfo->maxIdDigits = floor(log10(maxId)) + 1;
+  }
+
+  if (maxLinks == 0) {
+    pFileGroupInfo->maxLinksDigits = 1;
+  } else {
+    pFileGroupInfo->maxLinksDigits = floor(log10(maxLinks)) + 1;
+  }
+
+  if (maxSize == 0) {
+    pFileGroupInfo->maxSizeDigits = 1;
+  } else {
+    pFileGroupInfo->maxSizeDigits = floor(log10(maxSize)) + 1;
+  }
+
+  pFileGroupInfo->hasSpecialCharacters = hasSpecialCharacters;
+
+  pFileGroupInfo->maxUserLetters = maxUserLetters;
+  pFileGroupInfo->maxGroupLetters = maxGroupLetters;
+
+  return;
+}
+
+// Print an error message that mentions a file name
+// With the --format option, the message is printed as an error record instead
+void Details_printError(Output* out, char* message, char* filename, char* reason, Options* pOptions) {
+  if (pOptions->format != FORMAT_TEXT) {
+    Record_writeError(out, message, filename, reason, pOptions->format);
+    return;
+  }
+
+  Output_writeString(out, message);
+  Output_writeString(out, filename);
+  Output_writeString(out, reason);
+  return;
+}
+
+// Print the file name of length characters, given its QUOTING_ flags
+// Prints using single quotes when the file name contains special characters
+// Prints using double quotes when the file name contains single quotes
+static void printFilename(Output* out, char* filename, int length, int quoting, bool addExtraSpace) {
+  if (quoting & QUOTING_SINGLE_QUOTE) {
+    Output_writeCharacter(out, '"');
+    Output_write(out, filename, length);
+    Output_writeCharacter(out, '"');
+  } else if (quoting & QUOTING_SPECIAL) {
+    Output_writeCharacter(out, '\'');
+    Output_write(out, filename, length);
+    Output_writeCharacter(out, '\'');
+  } else {
+    if (addExtraSpace) {
+      Output_writeCharacter(out, ' ');
+    }
+    Output_write(out, filename, length);
+  }
+
+  return;
+}
+
+// Prints out the details of a file or directory file
+// directoryFd is the directory that the entry name is relative to (or AT_FDCWD for paths)
+// It is used to read the target of symbolic links
+// With the --format option, the details are printed as an entry record instead
+void Details_printEntry(Output* out, FileEntry* pEntry, int directoryFd, FileGroupInfo* pInfo, Options* pOptions) {
+  if (pOptions->format != FORMAT_TEXT) {
+    Record_writeEntry(out, pEntry, directoryFd, pOptions->format);
+    return;
+  }
+
+  struct stat* pStatBuffer = &pEntry->statBuffer;
+  char modeBuffer[MODE_STRING_LENGTH];
+  char dateBuffer[DATE_STRING_LENGTH];
+  int userNameLength;
+  int groupNameLength;
+  char symbolicBuffer[PATH_MAX];
+
+  // If the -i option is used, print the index number of the file
+  if (pOptions->indexOption) {
+    Output_writeNumber(out, pStatBuffer->st_ino, pInfo->maxIdDigits);
+    Output_writeCharacter(out, ' ');
+  }
+
+  // If the -l option is used, Print the mode, # of hard links, user, group,
+  // size, and last modified date of the file
+  if (pOptions->longOption) {
+    char* userName = Helpers_getUserName(pStatBuffer->st_uid, &userNameLength);
+    char* groupName = Helpers_getGroupName(pStatBuffer->st_gid, &groupNameLength);
+
+    Output_write(out, Helpers_parseMode(pStatBuffer->st_mode, modeBuffer), MODE_STRING_LENGTH - 1);
+    Output_writeCharacter(out, ' ');
+    Output_writeNumber(out, pStatBuffer->st_nlink, pInfo->maxLinksDigits);
+    Output_writeCharacter(out, ' ');
+    Output_writePadded(out, userName, userNameLength, pInfo->maxUserLetters);
+    Output_writeCharacter(out, ' ');
+    Output_writePadded(out, groupName, groupNameLength, pInfo->maxGroupLetters);
+    Output_writeCharacter(out, ' ');
+    Output_writeNumber(out, pStatBuffer->st_size, pInfo->maxSizeDigits);
+    Output_writeCharacter(out, ' ');
+    Output_writeString(out, Helpers_parseDate(pStatBuffer->st_mtime, dateBuffer));
+    Output_writeCharacter(out, ' ');
+  }
+
+  // Print the file name
+  // Prints using single quotes when the file name contains special characters
+  // Prints using double quotes when the file name contains single quotes
+  printFilename(out, pEntry->name, pEntry->nameLength, pEntry->quoting, pInfo->hasSpecialCharacters);
+
+  // If the file is a symbolic link, print the file name that it points to
+  if (pOptions->longOption && S_ISLNK(pStatBuffer->st_mode)) {
+    int linkLength = readlinkat(directoryFd, pEntry->name, symbolicBuffer, PATH_MAX);
+
+    if (linkLength != -1) {
+      int terminateIndex = (linkLength < PATH_MAX) ? linkLength : PATH_MAX - 1;
+      symbolicBuffer[terminateIndex] = '\0';
+      Output_write(out, " -> ", 4);
+      printFilename(out, symbolicBuffer, terminateIndex, Quoting_classifyName(symbolicBuffer, terminateIndex), false);
+    }
+  }
+
+  Output_writeCharacter(out, '\n');
+  return;
+}
@@ -0,0 +1,40 @@
+// Handles printing the details of files and errors as text, or as records with the --format option
+#ifndef _DETAILS_H_
+#define _DETAILS_H_
+#include <stdbool.h>
+#include "options.h"
+#include "output.h"
+#include "entry.h"
+
+// Provides information about a group of files for print formatting
+typedef struct {
+  int maxIdDigits; // The max # of digits needed to represent any file's ID in the group
+  int maxLinksDigits; // The max # of digits needed to represent any file's hard link count
+  int maxSizeDigits; // The max # of digits needed to represent any file's size in the group
+  int maxUserLetters; // The max # of letters needed to represent any file's user name in the group
+  int maxGroupLetters; // The max # of letters needed to represent any file's group name in the group
+  bool hasSpecialCharacters; // At least one file contains special characters
+} FileGroupInfo;
+
+// Checks whether only the file type of entries is needed, which the directory entries usually provide
+// Every other option that prints or sorts by metadata needs each entry to be statted
+bool Details_isTypeOnly(Options* pOptions);
+
+// Gets information about a group of files and sets a struct with this info
+// Reads the metadata already recorded in each entry, so no files are accessed
+// Sets the quoting flags of every entry
+// Widths are only computed for the columns enabled by the options
+// Records printed with the --format option are not padded, so no widths are computed for them
+void Details_getGroupInfo(int entriesLength, FileEntry* entries, Options* pOptions, FileGroupInfo* pFileGroupInfo);
+
+// Print an error message that mentions a file name
+// With the --format option, the message is printed as an error record instead
+void Details_printError(Output* out, char* message, char* filename, char* reason, Options* pOptions);
+
+// Prints out the details of a file or directory file
+// directoryFd is the directory that the entry name is relative to (or AT_FDCWD for paths)
+// It is used to read the target of symbolic links
+// With the --format option, the details are printed as an entry record instead
+void Details_printEntry(Output* out, FileEntry* pEntry, int directoryFd, FileGroupInfo* pInfo, Options* pOptions);
+
+#endif
@@ -0,0 +1,499 @@
+// d_type is only declared for default sources
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "directory.h"
+#include "entry.h"
+#include "arena.h"
+#include "uring.h"
+#include "stats.h"
+#include "prune.h"
+
+// The # of entries a directory needs before its metadata is fetched with io_uring
+#define URING_MIN_ENTRIES 16
+
+// The # of entries a directory needs before its entries are statted in inode order
+#define INODE_ORDER_MIN_ENTRIES 64
+
+// Initial # of entries an EntryCollector can hold before growing
+#define INITIAL_COLLECTOR_CAPACITY 64
+
+// Initial # of directories the stack of a walk can hold before growing
+#define INITIAL_FRAMES_CAPACITY 64
+
+// The # of directories kept open at a time by a walk, if no other limit is provided
+// Lowered to a quarter of the open file limit of the process, leaving descriptors for everything else
+#define DEFAULT_OPEN_LIMIT 256
+
+// A growable array of entries read from a directory stream
+typedef struct {
+  int capacity; // The # of entries the array can hold before it must grow
+  FileEntry* entries; // The recorded entries
+  Arena* pArena; // The arena that the filenames are packed into
+} EntryCollector;
+
+// Opens a directory stream for a directory name relative to parentFd (or AT_FDCWD for paths)
+// Returns NULL if the directory could not be opened
+DIR* Directory_open(int parentFd, const char* directoryName) {
+  int directoryFd = openat(parentFd, directoryName, O_RDONLY | O_DIRECTORY);
+
+  if (directoryFd == -1) {
+    return NULL;
+  }
+
+  DIR* directoryStream = fdopendir(directoryFd);
+
+  if (directoryStream == NULL) {
+    close(directoryFd);
+  }
+
+  return directoryStream;
+}
+
+// Gets the file type bits (as in st_mode) of a directory entry
+// Returns 0 if the file system does not provide the type
+mode_t Directory_getEntryType(struct dirent* pDirectoryEntry) {
+#ifdef DT_UNKNOWN
+  switch (pDirectoryEntry->d_type) {
+    case DT_REG: return S_IFREG;
+    case DT_DIR: return S_IFDIR;
+    case DT_LNK: return S_IFLNK;
+    case DT_FIFO: return S_IFIFO;
+    case DT_SOCK: return S_IFSOCK;
+    case DT_CHR: return S_IFCHR;
+    case DT_BLK: return S_IFBLK;
+  }
+#endif
+
+  return 0;
+}
+
+// Reads the next directory entry, skipping hidden files and the '.' and '..' directories
+// Returns NULL at the end of the directory
+struct dirent* Directory_readVisibleEntry(DIR* directoryStream) {
+  struct dirent* pDirectoryEntry;
+
+  do {
+    pDirectoryEntry = readdir(directoryStream);
+  } while (pDirectoryEntry != NULL && pDirectoryEntry->d_name[0] == '.');
+
+  return pDirectoryEntry;
+}
+
+// Records the filename from a directory entry into a growable entry array
+// The array doubles in capacity whenever it fills, so the directory is only read once
+// Each filename is packed into the collector's arena with its exact length
+static void recordFilename(EntryCollector* pCollector, int index, struct dirent* pDirectoryEntry) {
+  if (index == pCollector->capacity) {
+    pCollector->capacity = (pCollector->capacity == 0) ? INITIAL_COLLECTOR_CAPACITY : pCollector->capacity * 2;
+    pCollector->entries = realloc(pCollector->entries, sizeof(FileEntry) * pCollector->capacity);
+  }
+
+  int nameLength = strlen(pDirectoryEntry->d_name);
+  pCollector->entries[index].name = Arena_copyString(pCollector->pArena, pDirectoryEntry->d_name, nameLength);
+  pCollector->entries[index].nameLength = nameLength;
+  pCollector->entries[index].type = Directory_getEntryType(pDirectoryEntry);
+  pCollector->entries[index].inode = pDirectoryEntry->d_ino;
+
+  return;
+}
+
+// Reads every visible entry of an open directory stream in a single pass
+// Entries excluded by pPruner are skipped before their names are copied, unless it is NULL
+// Sets the array pointer for the entries, and returns their #
+int Directory_readEntries(DIR* directoryStream, Arena* pArena, Pruner* pPruner, FileEntry** pEntries) {
+  EntryCollector collector = {0, NULL, pArena};
+  int length = 0;
+  struct dirent* pDirectoryEntry;
+
+  while ((pDirectoryEntry = Directory_readVisibleEntry(directoryStream)) != NULL) {
+    if (pPruner != NULL && Prune_isExcluded(pPruner, pDirectoryEntry->d_name, strlen(pDirectoryEntry->d_name))) {
+      continue;
+    }
+
+    recordFilename(&collector, length, pDirectoryEntry);
+    length++;
+  }
+
+  *pEntries = collector.entries;
+  return length;
+}
+
+// An entry index paired with its inode #, for sorting entries into inode order
+typedef struct {
+  ino_t inode; // The inode # of the entry
+  int index; // The index of the entry
+} InodeKey;
+
+static int compareInodeKeys(const void* pA, const void* pB) {
+  const InodeKey* pKeyA = pA;
+  const InodeKey* pKeyB = pB;
+
+  if (pKeyA->inode != pKeyB->inode) {
+    return (pKeyA->inode < pKeyB->inode) ? -1 : 1;
+  }
+
+  return pKeyA->index - pKeyB->index;
+}
+
+// Gets the order to stat the entries of a directory in, sorted by the inode #s from the directory entries
+// Inodes are laid out in inode # order on most file systems, so a cold stat pass reads the inode table
+// in sequence instead of seeking back and forth across it in name order
+// With isUnknownOnly set, only the entries whose type the directory entry did not provide are ordered
+// Sets the # of ordered entries, and returns NULL to stat them in array order, for small directories or when
+// an inode # is unknown
+// Returned order must eventually be freed
+static int* getInodeOrder(int entriesLength, FileEntry* entries, bool isUnknownOnly, int* pOrderLength) {
+  InodeKey* keys = malloc(sizeof(InodeKey) * entriesLength);
+  int keysLength = 0;
+
+  for (int i = 0; i < entriesLength; i++) {
+    if (isUnknownOnly && entries[i].type != 0) {
+      continue;
+    }
+
+    keys[keysLength].inode = entries[i].inode;
+    keys[keysLength].index = i;
+    keysLength++;
+  }
+
+  *pOrderLength = keysLength;
+
+  if (keysLength < INODE_ORDER_MIN_ENTRIES) {
+    free(keys);
+    return NULL;
+  }
+
+  for (int i = 0; i < keysLength; i++) {
+    if (keys[i].inode == 0) {
+      free(keys);
+      return NULL;
+    }
+  }
+
+  qsort(keys, keysLength, sizeof(InodeKey), compareInodeKeys);
+
+  int* order = malloc(sizeof(int) * keysLength);
+  for (int i = 0; i < keysLength; i++) {
+    order[i] = keys[i].index;
+  }
+
+  free(keys);
+  return order;
+}
+
+// Gets the metadata of every entry in a directory, relative to directoryFd
+// Results are stored in each entry, so they stay in the array order however they are fetched
+void Directory_statEntries(int directoryFd, int entriesLength, FileEntry* entries, bool isTypeOnly, bool useUring, bool useInodeOrder) {
+  long startTime = Stats_start();
+
+  if (isTypeOnly) {
+    int statsLength = 0;
+
+    for (int i = 0; i < entriesLength; i++) {
+      if (entries[i].type == 0) {
+        statsLength++;
+      } else {
+        memset(&entries[i].statBuffer, 0, sizeof(struct stat));
+        entries[i].statBuffer.st_mode = entries[i].type;
+      }
+    }
+
+    // Most file systems provide every type, so no order is needed when nothing is statted
+    if (statsLength > 0) {
+      int orderLength = 0;
+      int* order = useInodeOrder ? getInodeOrder(entriesLength, entries, true, &orderLength) : NULL;
+
+      if (order != NULL) {
+        for (int k = 0; k < orderLength; k++) {
+          FileEntry* pEntry = &entries[order[k]];
+          fstatat(directoryFd, pEntry->name, &pEntry->statBuffer, AT_SYMLINK_NOFOLLOW);
+        }
+      } else {
+        for (int i = 0; i < entriesLength; i++) {
+          if (entries[i].type == 0) {
+            fstatat(directoryFd, entries[i].name, &entries[i].statBuffer, AT_SYMLINK_NOFOLLOW);
+          }
+        }
+      }
+
+      free(order);
+    }
+
+    Stats_stop(STATS_STAT, statsLength, startTime);
+    return;
+  }
+
+  int orderLength = 0;
+  int* order = useInodeOrder ? getInodeOrder(entriesLength, entries, false, &orderLength) : NULL;
+
+  if (useUring && entriesLength >= URING_MIN_ENTRIES) {
+    if (Uring_statEntries(directoryFd, entriesLength, entries, order)) {
+      free(order);
+      Stats_stop(STATS_STAT, entriesLength, startTime);
+      return;
+    }
+  }
+
+  for (int k = 0; k < entriesLength; k++) {
+    int i = (order == NULL) ? k : order[k];
+    fstatat(directoryFd, entries[i].name, &entries[i].statBuffer, AT_SYMLINK_NOFOLLOW);
+  }
+
+  free(order);
+  Stats_stop(STATS_STAT, entriesLength, startTime);
+  return;
+}
+
+// Gets the # of directories a walk keeps open at a time when no other limit is provided
+int Directory_getDefaultOpenLimit() {
+  struct rlimit fileLimit;
+
+  if (getrlimit(RLIMIT_NOFILE, &fileLimit) == 0 && fileLimit.rlim_cur != RLIM_INFINITY && fileLimit.rlim_cur / 4 < DEFAULT_OPEN_LIMIT) {
+    return (fileLimit.rlim_cur < 4) ? 1 : fileLimit.rlim_cur / 4;
+  }
+
+  return DEFAULT_OPEN_LIMIT;
+}
+
+// Stats the subdirectories of a directory again when only their file type was needed, so their device is known
+// Entries of unknown type were already fully statted
+void Directory_statDevices(int directoryFd, int entriesLength, FileEntry* entries) {
+  for (int i = 0; i < entriesLength; i++) {
+    if (entries[i].type != 0 && S_ISDIR(entries[i].statBuffer.st_mode)) {
+      fstatat(directoryFd, entries[i].name, &entries[i].statBuffer, AT_SYMLINK_NOFOLLOW);
+    }
+  }
+
+  return;
+}
+
+// Sets the path of a walk to a name inside the directory whose path is the first parentLength bytes
+// The path stays null terminated
+static void setWalkPath(Output* pPath, size_t parentLength, char* name) {
+  pPath->length = parentLength;
+
+  if (parentLength > 0 && pPath->data[parentLength - 1] != '/') {
+    Output_writeCharacter(pPath, '/');
+  }
+
+  Output_writeString(pPath, name);
+  Output_writeCharacter(pPath, '\0');
+  pPath->length--;
+
+  return;
+}
+
+// Starts a walk at a directory path, which is opened relative to the working directory
+// Returns the open directory, or NULL if it could not be opened
+DIR* Directory_startWalk(DirectoryWalk* pWalk, char* directoryPath, int openLimit) {
+  memset(pWalk, 0, sizeof(DirectoryWalk));
+  pWalk->openLimit = openLimit;
+  Output_initMemory(&pWalk->path);
+  setWalkPath(&pWalk->path, 0, directoryPath);
+
+  DIR* directoryStream = Directory_open(AT_FDCWD, directoryPath);
+  pWalk->openLength = (directoryStream == NULL) ? 0 : 1;
+  return directoryStream;
+}
+
+// Packs the names of subdirectories one after another, each with its null terminator
+// Sets the pointer to the end of the packed names
+// Returned names must eventually be freed
+static char* packDirectoryNames(int directoriesLength, char** directories, char** pEnd) {
+  size_t length = 0;
+
+  for (int i = 0; i < directoriesLength; i++) {
+    length += strlen(directories[i]) + 1;
+  }
+
+  char* names = malloc(length);
+  char* pName = names;
+
+  for (int i = 0; i < directoriesLength; i++) {
+    size_t nameLength = strlen(directories[i]) + 1;
+    memcpy(pName, directories[i], nameLength);
+    pName += nameLength;
+  }
+
+  *pEnd = pName;
+  return names;
+}
+
+// Pushes the directory being visited onto the stack of a walk, with the names of its subdirectories to visit next
+void Directory_pushWalk(DirectoryWalk* pWalk, DIR* directoryStream, char* name, int directoriesLength, char** directories, void* pData) {
+  if (pWalk->framesLength == pWalk->framesCapacity) {
+    pWalk->framesCapacity = (pWalk->framesCapacity == 0) ? INITIAL_FRAMES_CAPACITY : pWalk->framesCapacity * 2;
+    pWalk->frames = realloc(pWalk->frames, sizeof(DirectoryFrame) * pWalk->framesCapacity);
+  }
+
+  DirectoryFrame* pFrame = &pWalk->frames[pWalk->framesLength];
+  pWalk->framesLength++;
+
+  pFrame->name = name;
+  pFrame->directoryStream = directoryStream;
+  pFrame->pathLength = pWalk->path.length;
+  pFrame->subdirectories = packDirectoryNames(directoriesLength, directories, &pFrame->pSubdirectoriesEnd);
+  pFrame->pNextSubdirectory = pFrame->subdirectories;
+  pFrame->hasCloseError = false;
+  pFrame->pData = pData;
+  return;
+}
+
+// Closes the directory being visited when it has no subdirectories to visit
+// Returns false if it could not be closed
+bool Directory_closeWalk(DirectoryWalk* pWalk, DIR* directoryStream) {
+  pWalk->openLength--;
+  return closedir(directoryStream) == 0;
+}
+
+// Gets the name of the next subdirectory of the deepest directory of a walk, and sets the walk path to it
+// Returns NULL once all of its subdirectories have been visited
+char* Directory_nextWalk(DirectoryWalk* pWalk) {
+  DirectoryFrame* pFrame = &pWalk->frames[pWalk->framesLength - 1];
+
+  if (pFrame->pNextSubdirectory == pFrame->pSubdirectoriesEnd) {
+    return NULL;
+  }
+
+  char* name = pFrame->pNextSubdirectory;
+  pFrame->pNextSubdirectory += strlen(name) + 1;
+
+  setWalkPath(&pWalk->path, pFrame->pathLength, name);
+  return name;
+}
+
+// Closes the shallowest open directories of a walk until no more than the open limit are open
+// The directories are opened again by name if more of their subdirectories need to be opened
+static void limitOpenDirectories(DirectoryWalk* pWalk) {
+  while (pWalk->openLength > pWalk->openLimit && pWalk->closeIndex < pWalk->framesLength) {
+    DirectoryFrame* pFrame = &pWalk->frames[pWalk->closeIndex];
+    pWalk->closeIndex++;
+
+    if (pFrame->directoryStream == NULL) {
+      continue;
+    }
+
+    if (closedir(pFrame->directoryStream) == -1) {
+      pFrame->hasCloseError = true;
+    }
+    pFrame->directoryStream = NULL;
+    pWalk->openLength--;
+  }
+
+  return;
+}
+
+// Opens a directory of a walk again after it was closed to stay within the open limit
+// Each directory between it and its nearest open ancestor (or the working directory) is opened by name in turn,
+// so the path length is never limited by PATH_MAX
+// Leaves the directory closed if it can no longer be opened
+static void reopenWalkFrame(DirectoryWalk* pWalk, int index) {
+  DirectoryFrame* frames = pWalk->frames;
+  int ancestorIndex = index - 1;
+
+  while (ancestorIndex >= 0 && frames[ancestorIndex].directoryStream == NULL) {
+    ancestorIndex--;
+  }
+
+  int fd = (ancestorIndex < 0) ? AT_FDCWD : dirfd(frames[ancestorIndex].directoryStream);
+
+  for (int i = ancestorIndex + 1; i <= index && fd != -1; i++) {
+    int nextFd = openat(fd, frames[i].name, O_RDONLY | O_DIRECTORY);
+
+    // Directories in between are only needed to open the next one
+    if (i > ancestorIndex + 1) {
+      close(fd);
+    }
+
+    fd = nextFd;
+  }
+
+  if (fd == -1) {
+    return;
+  }
+
+  frames[index].directoryStream = fdopendir(fd);
+
+  if (frames[index].directoryStream == NULL) {
+    close(fd);
+    return;
+  }
+
+  pWalk->openLength++;
+  if (index < pWalk->closeIndex) {
+    pWalk->closeIndex = index;
+  }
+
+  return;
+}
+
+// Opens a subdirectory name returned by Directory_nextWalk, relative to the deepest directory of a walk
+// Returns NULL if the subdirectory could not be opened
+DIR* Directory_openWalk(DirectoryWalk* pWalk, char* name) {
+  int index = pWalk->framesLength - 1;
+  DirectoryFrame* pFrame = &pWalk->frames[index];
+
+  if (pFrame->directoryStream == NULL) {
+    reopenWalkFrame(pWalk, index);
+  }
+
+  if (pFrame->directoryStream == NULL) {
+    return NULL;
+  }
+
+  DIR* directoryStream = Directory_open(dirfd(pFrame->directoryStream), name);
+
+  if (directoryStream != NULL) {
+    pWalk->openLength++;
+    limitOpenDirectories(pWalk);
+  }
+
+  return directoryStream;
+}
+
+// Pops the deepest directory of a walk once all of its subdirectories have been visited, and closes it
+// Returns false if it could not be closed
+bool Directory_popWalk(DirectoryWalk* pWalk, size_t* pPathLength, void** pData) {
+  DirectoryFrame* pFrame = &pWalk->frames[pWalk->framesLength - 1];
+
+  if (pFrame->directoryStream != NULL) {
+    if (closedir(pFrame->directoryStream) == -1) {
+      pFrame->hasCloseError = true;
+    }
+    pWalk->openLength--;
+  }
+
+  free(pFrame->subdirectories);
+  pWalk->framesLength--;
+
+  if (pWalk->closeIndex > pWalk->framesLength) {
+    pWalk->closeIndex = pWalk->framesLength;
+  }
+
+  *pPathLength = pFrame->pathLength;
+  *pData = pFrame->pData;
+  return !pFrame->hasCloseError;
+}
+
+// Frees a walk, closing any directories left on its stack
+void Directory_freeWalk(DirectoryWalk* pWalk) {
+  for (int i = 0; i < pWalk->framesLength; i++) {
+    if (pWalk->frames[i].directoryStream != NULL) {
+      closedir(pWalk->frames[i].directoryStream);
+    }
+    free(pWalk->frames[i].subdirectories);
+  }
+
+  free(pWalk->frames);
+  Output_free(&pWalk->path);
+  memset(pWalk, 0, sizeof(DirectoryWalk));
+  return;
+}
@@ -0,0 +1,109 @@
+// Handles reading and statting the entries of directories
+#ifndef _DIRECTORY_H_
+#define _DIRECTORY_H_
+#include <stdbool.h>
+#include <dirent.h>
+#include "entry.h"
+#include "arena.h"
+#include "prune.h"
+#include "output.h"
+
+// A directory with subdirectories still to be visited, on the stack of a walk
+typedef struct {
+  char* name; // The directory name relative to its parent (or the path for the directory the walk started at)
+  DIR* directoryStream; // The open directory, or NULL if it was closed to stay within the open limit
+  size_t pathLength; // The length of the directory path, which is the start of the walk path
+  char* subdirectories; // The names of the subdirectories, packed one after another with null terminators
+  char* pNextSubdirectory; // The next subdirectory name to visit
+  char* pSubdirectoriesEnd; // The end of the packed subdirectory names
+  bool hasCloseError; // The directory stream could not be closed
+  void* pData; // Data kept with the directory by the caller of the walk, or NULL
+} DirectoryFrame;
+
+// The state of an iterative depth-first walk of a directory and its subdirectories
+// Subdirectories are visited with an explicit stack instead of recursion, holding only the packed names of the
+// subdirectories still to be visited and a single shared path, so memory grows with depth and pending names
+// Each subdirectory is opened relative to its open parent, so the kernel never re-walks the path
+// At most openLimit directories are kept open, and the shallowest are closed first when there are more
+typedef struct {
+  int openLimit; // The most directories kept open at a time
+  int framesLength; // The # of directories on the stack
+  int framesCapacity; // The # of directories the stack can hold before it must grow
+  DirectoryFrame* frames; // The stack of directories, from the directory the walk started at to the deepest one
+  Output path; // Memory buffer holding the null terminated path of the directory being visited
+  int openLength; // The # of directories currently open
+  int closeIndex; // The index of the shallowest directory on the stack that may still be open
+} DirectoryWalk;
+
+// Opens a directory stream for a directory name relative to parentFd (or AT_FDCWD for paths)
+// Returns NULL if the directory could not be opened
+DIR* Directory_open(int parentFd, const char* directoryName);
+
+// Reads the next directory entry, skipping hidden files and the '.' and '..' directories
+// Returns NULL at the end of the directory
+struct dirent* Directory_readVisibleEntry(DIR* directoryStream);
+
+// Gets the file type bits (as in st_mode) of a directory entry
+// Returns 0 if the file system does not provide the type
+mode_t Directory_getEntryType(struct dirent* pDirectoryEntry);
+
+// Reads every visible entry of an open directory stream in a single pass
+// Filenames are packed into pArena, and each entry has its type set from the directory entry
+// Entries whose names match pPruner (--exclude) are skipped before they are recorded, unless it is NULL
+// Sets the array pointer for the entries, and returns their #
+// entries array must eventually be freed
+int Directory_readEntries(DIR* directoryStream, Arena* pArena, Pruner* pPruner, FileEntry** pEntries);
+
+// Gets the metadata of every entry in a directory, relative to directoryFd
+// With isTypeOnly set only the file type is needed, which is taken from the directory entry when the
+// file system provides it. Only entries of unknown type are statted
+// With useUring set, large directories are statted with batches of asynchronous io_uring requests
+// Falls back to one fstatat call per entry when io_uring is unavailable
+// With useInodeOrder set, large directories are statted in the order of their inode #s, and each result
+// is still stored in its own entry, so the entries keep their order
+void Directory_statEntries(int directoryFd, int entriesLength, FileEntry* entries, bool isTypeOnly, bool useUring, bool useInodeOrder);
+
+// Stats the subdirectories of a directory again when only their file type was needed, so their device is known
+// Used by the -x option, which skips subdirectories on other devices
+// Entries of unknown type were already fully statted by Directory_statEntries, so they are not statted again
+void Directory_statDevices(int directoryFd, int entriesLength, FileEntry* entries);
+
+// Gets the # of directories a walk keeps open at a time when no other limit is provided
+// This is 256, or a quarter of the open file limit of the process if that is lower
+int Directory_getDefaultOpenLimit();
+
+// Starts a walk at a directory path, which is opened relative to the working directory
+// At most openLimit directories are kept open at a time
+// Returns the open directory, or NULL if it could not be opened
+// The walk must eventually be freed
+DIR* Directory_startWalk(DirectoryWalk* pWalk, char* directoryPath, int openLimit);
+
+// Pushes the directory being visited onto the stack of a walk, with the names of its subdirectories to visit next
+// name is the directory name relative to its parent, and must stay valid until the directory is popped
+// The subdirectory names are copied, so they can be freed once the directory is pushed
+void Directory_pushWalk(DirectoryWalk* pWalk, DIR* directoryStream, char* name, int directoriesLength, char** directories, void* pData);
+
+// Closes the directory being visited when it has no subdirectories to visit, so it is never pushed
+// Returns false if it could not be closed
+bool Directory_closeWalk(DirectoryWalk* pWalk, DIR* directoryStream);
+
+// Gets the name of the next subdirectory of the deepest directory of a walk, and sets the walk path to it
+// Returns NULL once all of its subdirectories have been visited, and it must then be popped
+char* Directory_nextWalk(DirectoryWalk* pWalk);
+
+// Opens a subdirectory name returned by Directory_nextWalk, relative to the deepest directory of a walk
+// The deepest directory is opened again first if it was closed to stay within the open limit,
+// and the shallowest open directories are closed if more than the limit are open afterwards
+// Returns NULL if the subdirectory could not be opened
+DIR* Directory_openWalk(DirectoryWalk* pWalk, char* name);
+
+// Pops the deepest directory of a walk once all of its subdirectories have been visited, and closes it
+// Sets the length of its path, which is the start of the walk path, and the data it was pushed with
+// Returns false if it could not be closed
+bool Directory_popWalk(DirectoryWalk* pWalk, size_t* pPathLength, void** pData);
+
+// Frees a walk, closing any directories left on its stack
+// Data that was pushed with them is not freed
+void Directory_freeWalk(DirectoryWalk* pWalk);
+
+#endif
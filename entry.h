@@ -0,0 +1,18 @@
+// Handles file entry records
+#ifndef _ENTRY_H_
+#define _ENTRY_H_
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// A file or directory along with its metadata
+// The metadata is gathered with a single lstat call and shared by every step of a listing
+typedef struct {
+  char* name; // The file name (or the file path for command line arguments)
+  int nameLength; // The length of the name
+  mode_t type; // The file type bits from the directory entry, or 0 if unknown
+  ino_t inode; // The inode # from the directory entry, or 0 if unknown
+  int quoting; // The QUOTING_ flags of the name, set when column widths are computed for text output
+  struct stat statBuffer; // The lstat result for the file (only the file type when no other metadata is needed)
+} FileEntry;
+
+#endif
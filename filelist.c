@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "filelist.h"
+#include "directory.h"
+#include "entry.h"
+#include "arena.h"
+#include "sort.h"
+#include "prune.h"
+
+struct FileList {
+  FileListOptions options; // The options the listing was opened with
+  Pruner* pPruner; // The compiled exclude patterns, or NULL if there are none
+  char* directoryPath; // A copy of the listed path, which the walk refers to until it is done
+  DirectoryWalk walk; // The walk of the listed directory, whose path is the path of the directory being yielded
+  DIR* directoryStream; // The directory whose entries are being yielded, or NULL once they all have been
+  char* directoryName; // The name of that directory relative to its parent (or the listed path)
+  dev_t directoryDevice; // The device of that directory when the oneFileSystem option is used, or 0
+  Arena arena; // Holds the entry names of that directory
+  int entriesLength; // The # of entries in that directory
+  FileEntry* entries; // The entries of that directory, sorted unless the unsorted option is used
+  int entryIndex; // The index of the next entry to yield
+  int errorsCount; // The # of subdirectories that could not be opened
+  FileListEntry entry; // The most recently yielded entry
+};
+
+// Reads, sorts and stats every entry of an open directory, which becomes the directory being yielded
+// Entries whose names match an exclude pattern are skipped as they are read
+static void loadDirectory(FileList* pList, DIR* directoryStream, char* name) {
+  FileListOptions* pOptions = &pList->options;
+  int directoryFd = dirfd(directoryStream);
+
+  pList->directoryStream = directoryStream;
+  pList->directoryName = name;
+  Arena_init(&pList->arena);
+  pList->entriesLength = Directory_readEntries(directoryStream, &pList->arena, pList->pPruner, &pList->entries);
+  pList->entryIndex = 0;
+
+  if (!pOptions->unsorted) {
+    Sort_lexicographicalSort(pList->entriesLength, pList->entries);
+  }
+
+  Directory_statEntries(directoryFd, pList->entriesLength, pList->entries, pOptions->typeOnly, pOptions->uring, !pOptions->noInodeOrder);
+
+  // With the oneFileSystem option, subdirectories on other devices are yielded but never listed
+  pList->directoryDevice = 0;
+
+  if (pOptions->recursive && pOptions->oneFileSystem) {
+    struct stat directoryStatBuffer;
+
+    if (pOptions->typeOnly) {
+      Directory_statDevices(directoryFd, pList->entriesLength, pList->entries);
+    }
+
+    if (fstat(directoryFd, &directoryStatBuffer) == 0) {
+      pList->directoryDevice = directoryStatBuffer.st_dev;
+    }
+  }
+
+  return;
+}
+
+// Checks whether an entry of the directory being yielded is a subdirectory that is listed after it
+static bool isDescended(FileList* pList, FileEntry* pEntry) {
+  if (!S_ISDIR(pEntry->statBuffer.st_mode)) {
+    return false;
+  }
+
+  return pList->directoryDevice == 0 || pEntry->statBuffer.st_dev == pList->directoryDevice;
+}
+
+// Finishes the directory being yielded once all of its entries have been
+// With the recursive option, a directory with subdirectories is pushed onto the walk with their names
+// Otherwise it is closed right away
+static void finishDirectory(FileList* pList) {
+  int directoriesLength = 0;
+  char** directories = NULL;
+  int depth = pList->walk.framesLength;
+
+  if (pList->options.recursive && (pList->options.maxDepth == -1 || depth < pList->options.maxDepth)) {
+    directories = malloc(sizeof(char*) * pList->entriesLength);
+
+    // The names are pushed in the order their entries were yielded
+    for (int i = 0; i < pList->entriesLength; i++) {
+      if (isDescended(pList, &pList->entries[i])) {
+        directories[directoriesLength] = pList->entries[i].name;
+        directoriesLength++;
+      }
+    }
+  }
+
+  if (directoriesLength == 0) {
+    Directory_closeWalk(&pList->walk, pList->directoryStream);
+  } else {
+    Directory_pushWalk(&pList->walk, pList->directoryStream, pList->directoryName, directoriesLength, directories, NULL);
+  }
+
+  free(directories);
+  free(pList->entries);
+  pList->entries = NULL;
+  pList->entriesLength = 0;
+  Arena_free(&pList->arena);
+  pList->directoryStream = NULL;
+  return;
+}
+
+// Opens a listing of a directory
+FileList* FileList_open(const char* directoryPath, const FileListOptions* pOptions) {
+  FileList* pList = calloc(1, sizeof(FileList));
+
+  if (pOptions != NULL) {
+    pList->options = *pOptions;
+  } else {
+    pList->options.maxDepth = -1;
+  }
+
+  int openLimit = (pList->options.openLimit > 0) ? pList->options.openLimit : Directory_getDefaultOpenLimit();
+  pList->directoryPath = strdup(directoryPath);
+  DIR* directoryStream = Directory_startWalk(&pList->walk, pList->directoryPath, openLimit);
+
+  if (directoryStream == NULL) {
+    Directory_freeWalk(&pList->walk);
+    free(pList->directoryPath);
+    free(pList);
+    return NULL;
+  }
+
+  if (pList->options.excludePatternsLength > 0) {
+    pList->pPruner = Prune_compile(pList->options.excludePatternsLength, pList->options.excludePatterns);
+  }
+
+  loadDirectory(pList, directoryStream, pList->directoryPath);
+  return pList;
+}
+
+// Gets the next entry of a listing
+// Subdirectories are listed in depth-first order, each opened relative to its parent
+const FileListEntry* FileList_next(FileList* pList) {
+  while (true) {
+    if (pList->directoryStream != NULL && pList->entryIndex < pList->entriesLength) {
+      FileEntry* pEntry = &pList->entries[pList->entryIndex];
+      FileListEntry* pListEntry = &pList->entry;
+      pList->entryIndex++;
+
+      pListEntry->directoryPath = pList->walk.path.data;
+      pListEntry->depth = pList->walk.framesLength;
+      pListEntry->name = pEntry->name;
+      pListEntry->nameLength = pEntry->nameLength;
+      pListEntry->type = pEntry->statBuffer.st_mode & S_IFMT;
+      pListEntry->statBuffer = pEntry->statBuffer;
+      return pListEntry;
+    }
+
+    if (pList->directoryStream != NULL) {
+      finishDirectory(pList);
+    }
+
+    if (pList->walk.framesLength == 0) {
+      return NULL;
+    }
+
+    char* name = Directory_nextWalk(&pList->walk);
+
+    if (name == NULL) {
+      size_t pathLength;
+      void* pData;
+      Directory_popWalk(&pList->walk, &pathLength, &pData);
+      continue;
+    }
+
+    DIR* directoryStream = Directory_openWalk(&pList->walk, name);
+
+    if (directoryStream == NULL) {
+      pList->errorsCount++;
+      continue;
+    }
+
+    loadDirectory(pList, directoryStream, name);
+  }
+}
+
+// Gets the # of subdirectories that could not be opened so far
+int FileList_getErrorsCount(FileList* pList) {
+  return pList->errorsCount;
+}
+
+// Closes a listing and frees everything allocated for it
+void FileList_close(FileList* pList) {
+  if (pList->directoryStream != NULL) {
+    Directory_closeWalk(&pList->walk, pList->directoryStream);
+    free(pList->entries);
+    Arena_free(&pList->arena);
+  }
+
+  if (pList->pPruner != NULL) {
+    Prune_free(pList->pPruner);
+  }
+
+  Directory_freeWalk(&pList->walk);
+  free(pList->directoryPath);
+  free(pList);
+  return;
+}
+
+// Lists a directory, calling a function for every entry until it returns false
+int FileList_walk(const char* directoryPath, const FileListOptions* pOptions, FILELIST_FUNCTION pFunction, void* pArgument) {
+  FileList* pList = FileList_open(directoryPath, pOptions);
+
+  if (pList == NULL) {
+    return -1;
+  }
+
+  const FileListEntry* pEntry;
+
+  while ((pEntry = FileList_next(pList)) != NULL) {
+    if (!(*pFunction)(pEntry, pArgument)) {
+      break;
+    }
+  }
+
+  FileList_close(pList);
+  return 0;
+}
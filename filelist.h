@@ -0,0 +1,66 @@
+// The public interface of libfilelist, which lists directories in process
+// Entries are yielded as records with their raw name bytes and metadata, in the same order that list prints them
+#ifndef _FILELIST_H_
+#define _FILELIST_H_
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Marks the functions exported by libfilelist.so, as every other symbol of the library is hidden
+#define FILELIST_EXPORT __attribute__((visibility("default")))
+
+// The ways that a listing can be changed, matching the options of list
+// A zeroed struct lists a single directory in sorted order with the full metadata of every entry
+// maxDepth must be set to -1 for recursive to list every subdirectory, as a zeroed struct only lists the directory itself
+typedef struct {
+  bool recursive; // Also list every subdirectory after the entries of its parent (-R)
+  bool unsorted; // Yield entries in directory order, without sorting them (-U)
+  bool typeOnly; // Only the file type is needed, so entries are not statted when the directory records their type
+  bool uring; // Stat large directories with batches of io_uring requests when available (--io-uring)
+  bool noInodeOrder; // Stat large directories in name order instead of inode order (--no-inode-order)
+  int excludePatternsLength; // The # of glob patterns that entry names are excluded by (--exclude)
+  char** excludePatterns; // The glob patterns, which must stay valid until the listing is closed
+  int maxDepth; // The deepest subdirectory listed with recursive, relative to the listed directory, or -1 for no limit (--max-depth)
+  bool oneFileSystem; // Skip subdirectories on a different device than their parent directory (-x)
+  int openLimit; // The most directories kept open at a time with recursive, or 0 for 256 (or less with a low open file limit) (--max-open)
+} FileListOptions;
+
+// An entry yielded by a listing
+typedef struct {
+  const char* directoryPath; // The path of the directory holding the entry, starting with the listed path
+  int depth; // The # of directories between the entry's directory and the listed directory
+  const char* name; // The entry name, null terminated
+  int nameLength; // The length of the name
+  mode_t type; // The file type bits (as in st_mode)
+  struct stat statBuffer; // The lstat result for the entry (only st_mode is set when typeOnly is used)
+} FileListEntry;
+
+typedef struct FileList FileList;
+
+// Called for every entry by FileList_walk, with the entry and the argument passed to FileList_walk
+// Returns false to stop the listing early
+typedef bool (*FILELIST_FUNCTION)(const FileListEntry* pEntry, void* pArgument);
+
+// Opens a listing of a directory, which is read one directory at a time as entries are requested
+// pOptions may be NULL for the default options
+// Returns NULL and sets errno if the directory cannot be opened
+// Returned listing must eventually be closed
+FILELIST_EXPORT FileList* FileList_open(const char* directoryPath, const FileListOptions* pOptions);
+
+// Gets the next entry of a listing
+// The entry and its strings stay valid until the next call or until the listing is closed
+// Returns NULL once every entry has been yielded
+FILELIST_EXPORT const FileListEntry* FileList_next(FileList* pList);
+
+// Gets the # of subdirectories that could not be opened so far
+// Their entries are yielded by their parent, but they have no entries of their own
+FILELIST_EXPORT int FileList_getErrorsCount(FileList* pList);
+
+// Closes a listing and frees everything allocated for it
+FILELIST_EXPORT void FileList_close(FileList* pList);
+
+// Lists a directory, calling a function for every entry until it returns false
+// Returns 0 once the listing is done, or -1 and sets errno if the directory cannot be opened
+FILELIST_EXPORT int FileList_walk(const char* directoryPath, const FileListOptions* pOptions, FILELIST_FUNCTION pFunction, void* pArgument);
+
+#endif
@@ -4,160 +4,214 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <errno.h>
-#include <math.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "files.h"
 #include "options.h"
+#include "entry.h"
 #include "sort.h"
-#include "helpers.h"
-
-// Provides information about a group of files for print formatting
+#include "pool.h"
+#include "directory.h"
+#include "output.h"
+#include "arena.h"
+#include "index.h"
+#include "record.h"
+#include "stats.h"
+#include "top.h"
+#include "usage.h"
+#include "prune.h"
+#include "shard.h"
+#include "details.h"
+#include "watch.h"
+
+// The # of entries read, statted and printed at a time when the -U option is used
+#define STREAM_WINDOW_LENGTH 1024
+
+// Initial # of items a growable array can hold before growing
+#define INITIAL_ARRAY_CAPACITY 64
+
+// The # of directory tasks per -j thread that may be listed ahead of the printed output
+#define UNPRINTED_TASKS_PER_JOB 64
+
+// A directory listed by a worker thread when the -j option is used
+// Its output is buffered until every directory before it (in depth-first order) has been printed
+// The printing thread lists a task itself if no worker has started it when it is reached, so a task can still be in
+// a pool queue after it is printed. The task is freed by whichever of the worker and the printing thread is last
+typedef struct DirectoryTask {
+  struct DirectoryTask* pParent; // The task of the parent directory (NULL for command line arguments)
+  int depth; // The # of directories between this directory and its command line argument
+  char* name; // The directory name relative to the parent directory (or the path for command line arguments)
+  char* path; // The full path of the directory
+  Arena arena; // Holds the names and paths of the subdirectory tasks, freed along with the task
+  Options* pOptions; // The enabled options
+  DIR* directoryStream; // The open directory, kept open until all subdirectories have been opened, unless that
+                        // would keep more than the open limit open
+  int openChildrenLength; // The # of subdirectory tasks that have not yet opened their directory
+  bool hasCloseError; // The directory stream could not be closed
+  Output output; // The printed contents of the directory
+  int childrenLength; // The # of subdirectory tasks
+  struct DirectoryTask** children; // The subdirectory tasks, in sorted order
+  bool isStarted; // A thread has started listing the directory
+  bool isDone; // The directory has been listed and its subdirectory tasks created
+  bool isTaken; // The task has been taken from its pool queue by a worker, which no longer waits on it
+  bool isPrinted; // The output of the task and all of its subdirectory tasks has been printed
+  Usage usage; // The disk usage of the directory when the --du option is used, summed as its subdirectory tasks are printed
+} DirectoryTask;
+
+// A single large directory whose entries are split across threads when the -j option is used
+// Each thread stats, measures and formats a contiguous shard of the entries
+typedef struct {
+  int directoryFd; // The open directory, which the entry names are relative to
+  int entriesLength; // The # of entries in the directory
+  FileEntry* entries; // The entries of the directory, in the order they are printed
+  int shardsLength; // The # of shards the entries are split into
+  bool isTypeOnly; // Only the file type of the entries is needed
+  Options* pOptions; // The enabled options
+  FileGroupInfo* shardInfos; // Information about the entries of each shard
+  FileGroupInfo fileGroupInfo; // Information about every entry, combined from the shards
+  Output* outputs; // Memory buffers holding the printed entries of each shard
+} DirectoryShards;
+
+// The state of a traversal that prints a directory and its subdirectories
 typedef struct {
-  int maxIdDigits; // The max # of digits needed to represent any file's ID in the group
-  int maxLinksDigits; // The max # of digits needed to represent any file's hard link count
-  int maxSizeDigits; // The max # of digits needed to represent any file's size in the group
-  int maxUserLetters; // The max # of letters needed to represent any file's user name in the group
-  int maxGroupLetters; // The max # of letters needed to represent any file's group name in the group
-  bool hasSpecialCharacters; // At least one file contains special characters
-} FileGroupInfo;
+  Options* pOptions; // The enabled options
+  DirectoryWalk walk; // The walk of the directory, whose frames hold their disk usage when the --du option is used
+  TopHeap topHeap; // The best entries found so far when the --top option is used
+} Traversal;
 
-// Gets a file or directory path by combining its name with the parent directory path
-// Returned string must eventually be freed
-static char* getPath(char* filename, char* directoryPath) {
-  char* path = malloc(PATH_MAX);
+// Buffered standard output, which all listings are printed to
+static Output standardOutput;
 
-  strcpy(path, directoryPath);
+// The metadata index used by the --index option, or NULL if it is not used
+static Index* pMetadataIndex = NULL;
 
-  int directoryLength = strlen(directoryPath);
-  if (directoryPath[directoryLength - 1] != '/') {
-    strcat(path, "/");
-  }
+// The compiled patterns of the --exclude option, or NULL if it is not used
+static Pruner* pPruner = NULL;
 
-  strcat(path, filename);
+// The disk usage report of the command line directory being listed when the --du option is used
+// Only touched in depth-first order, by the traversal or by the thread printing directory tasks
+static UsageReport usageReport;
 
-  return path;
-}
+// Protects the state shared between directory tasks
+static pthread_mutex_t taskLock = PTHREAD_MUTEX_INITIALIZER;
 
-// Gets information about a group of files and sets a struct with this info
-// Pass directoryPath as NULL if all provided filenames are already valid paths
-static void getFileGroupInfo(int filenamesLength, char** filenames, char* directoryPath, FileGroupInfo* pFileGroupInfo) {
-  long maxId = 0;
-  long maxLinks = 0;
-  long maxSize = 0;
-  int maxUserLetters = 0;
-  int maxGroupLetters = 0;
-  bool hasSpecialCharacters = false;
+// Signalled whenever a directory task is done
+static pthread_cond_t taskDone = PTHREAD_COND_INITIALIZER;
 
-  for (int i = 0; i < filenamesLength; i++) {
-    struct stat statBuffer;
+// Signalled whenever the output of a directory task is printed
+static pthread_cond_t taskPrinted = PTHREAD_COND_INITIALIZER;
 
-    if (directoryPath == NULL) {
-      lstat(filenames[i], &statBuffer);
-    } else {
-      char* filePath = getPath(filenames[i], directoryPath);
-      lstat(filePath, &statBuffer);
-      free(filePath);
-      filePath = NULL;
-    }
+// The # of directory tasks that have been started and whose output has not been printed yet
+// Workers wait before starting another task while there are unprintedTasksLimit of them, so that the listing
+// kept in memory stays bounded when the workers run ahead of the printing thread
+static int unprintedTasksLength = 0;
+static int unprintedTasksLimit = 0;
 
-    char* specialCharacters = " !$^&()'`\"";
-    char* findSpecialCharacters = strpbrk(filenames[i], specialCharacters);
+// The # of directory tasks whose directory is open, which is kept within the --max-open limit once they are listed
+static int openTasksLength = 0;
 
-    if (findSpecialCharacters != NULL) {
-      hasSpecialCharacters = true;
-    }
+// Creates a task for listing a directory
+// name and path must stay valid until the task is freed
+static DirectoryTask* createDirectoryTask(DirectoryTask* pParent, char* name, char* path, Options* pOptions) {
+  DirectoryTask* pTask = calloc(1, sizeof(DirectoryTask));
 
-    if (statBuffer.st_ino > maxId) {
-      maxId = statBuffer.st_ino;
-    }
+  pTask->pParent = pParent;
+  pTask->depth = (pParent == NULL) ? 0 : pParent->depth + 1;
+  pTask->name = name;
+  pTask->path = path;
+  pTask->pOptions = pOptions;
+  Arena_init(&pTask->arena);
 
-    if (statBuffer.st_nlink > maxLinks) {
-      maxLinks = statBuffer.st_nlink;
-    }
+  return pTask;
+}
 
-    if (statBuffer.st_size > maxSize) {
-      maxSize = statBuffer.st_size;
-    }
+// Gets a file or directory path by combining its name with the parent directory path
+// The path is allocated from the arena with its exact length, so it may be longer than PATH_MAX
+static char* getPath(Arena* pArena, char* filename, char* directoryPath) {
+  int directoryLength = strlen(directoryPath);
+  int filenameLength = strlen(filename);
+  bool needsSeparator = directoryPath[directoryLength - 1] != '/';
+  char* path = Arena_allocate(pArena, directoryLength + needsSeparator + filenameLength + 1);
 
-    char* userName = Helpers_getUserName(statBuffer.st_uid);
-    int userNameLength = strlen(userName);
-    if (userNameLength > maxUserLetters) {
-      maxUserLetters = userNameLength;
-    }
+  memcpy(path, directoryPath, directoryLength);
 
-    char* groupName = Helpers_getGroupName(statBuffer.st_gid);
-    int groupNameLength = strlen(groupName);
-    if (groupNameLength > maxGroupLetters) {
-      maxGroupLetters = groupNameLength;
-    }
+  if (needsSeparator) {
+    path[directoryLength] = '/';
   }
 
-  if (maxId == 0) {
-    pFileGroupInfo->maxIdDigits = 1;
-  } else {
-    pFileGroupInfo->maxIdDigits = floor(log10(maxId)) + 1;
-  }
+  memcpy(path + directoryLength + needsSeparator, filename, filenameLength + 1);
 
-  if (maxLinks == 0) {
-    pFileGroupInfo->maxLinksDigits = 1;
-  } else {
-    pFileGroupInfo->maxLinksDigits = floor(log10(maxLinks)) + 1;
-  }
+  return path;
+}
 
-  if (maxSize == 0) {
-    pFileGroupInfo->maxSizeDigits = 1;
-  } else {
-    pFileGroupInfo->maxSizeDigits = floor(log10(maxSize)) + 1;
+// Print the name of a directory before its contents
+// Separates it from previous output with an empty line if addEmptyLine is set
+// With the --format option, the name is printed as a directory record instead
+static void printDirectoryName(Output* out, char* directoryPath, bool addEmptyLine, Options* pOptions) {
+  if (pOptions->format != FORMAT_TEXT) {
+    Record_writeDirectory(out, directoryPath, pOptions->format);
+    return;
   }
 
-  pFileGroupInfo->hasSpecialCharacters = hasSpecialCharacters;
-
-  pFileGroupInfo->maxUserLetters = maxUserLetters;
-  pFileGroupInfo->maxGroupLetters = maxGroupLetters;
+  if (addEmptyLine) {
+    Output_writeCharacter(out, '\n');
+  }
 
+  Output_writeString(out, directoryPath);
+  Output_write(out, ":\n", 2);
   return;
 }
 
-// Separates files and directories into two different arrays
+// Separates files and directories into two different arrays of entries
+// Each entry records the lstat result for its argument, so arguments are only accessed once
+// Entry names point to the provided filenames rather than copies
 // Sets the length and array pointer for both arrays
 // directories and files arrays must eventually be freed
-static void separateFilesAndDirectories(int filenamesLength, char** filenames, int* pDirectoriesLength, char*** pDirectories, int* pFilesLength, char*** pFiles, Options* pOptions) {
+static void separateFilesAndDirectories(int filenamesLength, char** filenames, int* pDirectoriesLength, FileEntry** pDirectories, int* pFilesLength, FileEntry** pFiles, Options* pOptions) {
   int status = 0;
   int filesLength = 0;
   int directoriesLength = 0;
-  char** files = malloc(sizeof(char*) * filenamesLength);
-  char** directories = malloc(sizeof(char*) * filenamesLength);
+  FileEntry* files = malloc(sizeof(FileEntry) * filenamesLength);
+  FileEntry* directories = malloc(sizeof(FileEntry) * filenamesLength);
 
   for (int i = 0; i < filenamesLength; i++) {
     struct stat statBuffer;
 
+    long startTime = Stats_start();
     status = lstat(filenames[i], &statBuffer);
+    Stats_stop(STATS_STAT, 1, startTime);
 
     // Error handling
     if (status == -1) {
       if (errno == ENAMETOOLONG) {
-        printf("list: cannot access '%s': File name too long\n", filenames[i]);
+        Details_printError(&standardOutput, "list: cannot access '", filenames[i], "': File name too long\n", pOptions);
       } else {
-        printf("list: cannot access '%s': No such file or directory\n", filenames[i]);
+        Details_printError(&standardOutput, "list: cannot access '", filenames[i], "': No such file or directory\n", pOptions);
       }
       continue;
     }
 
     // Handle directories
     if (S_ISDIR(statBuffer.st_mode)) {
-      directories[directoriesLength] = malloc(PATH_MAX);
-      strcpy(directories[directoriesLength], filenames[i]);
+      directories[directoriesLength].name = filenames[i];
+      directories[directoriesLength].nameLength = strlen(filenames[i]);
+      directories[directoriesLength].type = statBuffer.st_mode & S_IFMT;
+      directories[directoriesLength].inode = statBuffer.st_ino;
+      directories[directoriesLength].statBuffer = statBuffer;
       directoriesLength++;
       continue;
     }
 
     // Handle files
-    files[filesLength] = malloc(PATH_MAX);
-    strcpy(files[filesLength], filenames[i]);
+    files[filesLength].name = filenames[i];
+    files[filesLength].nameLength = strlen(filenames[i]);
+    files[filesLength].type = statBuffer.st_mode & S_IFMT;
+    files[filesLength].inode = statBuffer.st_ino;
+    files[filesLength].statBuffer = statBuffer;
     filesLength++;
   }
 
@@ -168,226 +222,796 @@ static void separateFilesAndDirectories(int filenamesLength, char** filenames, i
   return;
 }
 
+// Removes the entries whose names match an --exclude pattern, keeping the rest in order
+// Used for entries found in the index, which may have been recorded by a listing without --exclude
+// Returns the # of entries kept
+static int excludeEntries(int entriesLength, FileEntry* entries) {
+  int keptLength = 0;
+
+  for (int i = 0; i < entriesLength; i++) {
+    if (!Prune_isExcluded(pPruner, entries[i].name, entries[i].nameLength)) {
+      entries[keptLength] = entries[i];
+      keptLength++;
+    }
+  }
+
+  return keptLength;
+}
+
+// Gets the metadata of a range of entries in a directory
+// Safe to call from multiple threads for different entries
+static void fetchEntries(int directoryFd, int entriesLength, FileEntry* entries, bool isTypeOnly, Options* pOptions) {
+  Directory_statEntries(directoryFd, entriesLength, entries, isTypeOnly, pOptions->uringOption, pOptions->inodeOrderOption);
+
+  // With the -x option, subdirectories are also statted for their device when only the file type is needed
+  if (isTypeOnly && pOptions->oneFileSystemOption) {
+    Directory_statDevices(directoryFd, entriesLength, entries);
+  }
+
+  return;
+}
+
+// Gets the metadata of the entries in one shard of a directory
+// Passed as an argument to Shard_run
+static void statShard(int shardIndex, void* pArgument) {
+  DirectoryShards* pShards = pArgument;
+  int start, end;
+  Shard_getRange(pShards->entriesLength, pShards->shardsLength, shardIndex, &start, &end);
+
+  fetchEntries(pShards->directoryFd, end - start, pShards->entries + start, pShards->isTypeOnly, pShards->pOptions);
+  return;
+}
+
+// Gets information about the entries in one shard of a directory
+// Passed as an argument to Shard_run
+static void measureShard(int shardIndex, void* pArgument) {
+  DirectoryShards* pShards = pArgument;
+  int start, end;
+  Shard_getRange(pShards->entriesLength, pShards->shardsLength, shardIndex, &start, &end);
+
+  Details_getGroupInfo(end - start, pShards->entries + start, pShards->pOptions, &pShards->shardInfos[shardIndex]);
+  return;
+}
+
+// Prints the entries in one shard of a directory to the memory buffer of the shard
+// Passed as an argument to Shard_run
+static void printShard(int shardIndex, void* pArgument) {
+  DirectoryShards* pShards = pArgument;
+  Output* out = &pShards->outputs[shardIndex];
+  int start, end;
+  Shard_getRange(pShards->entriesLength, pShards->shardsLength, shardIndex, &start, &end);
+
+  Output_initMemory(out);
+  for (int i = start; i < end; i++) {
+    Details_printEntry(out, &pShards->entries[i], pShards->directoryFd, &pShards->fileGroupInfo, pShards->pOptions);
+  }
+
+  return;
+}
+
+// Prints the entries of a directory to out, split across shardsLength threads
+// Column widths are measured for each shard, combined into the widths of the whole directory,
+// then each shard is formatted into its own buffer and the buffers are written out in order
+static void printShardedEntries(Output* out, int directoryFd, int entriesLength, FileEntry* entries, int shardsLength, Options* pOptions) {
+  DirectoryShards shards = {directoryFd, entriesLength, entries, shardsLength, false, pOptions};
+  shards.shardInfos = malloc(sizeof(FileGroupInfo) * shardsLength);
+  shards.outputs = malloc(sizeof(Output) * shardsLength);
+
+  Shard_run(shardsLength, measureShard, &shards);
+
+  // Each width is the number of digits or letters of the largest value, so the widest shard decides it
+  FileGroupInfo* pInfo = &shards.fileGroupInfo;
+  *pInfo = shards.shardInfos[0];
+
+  for (int i = 1; i < shardsLength; i++) {
+    FileGroupInfo* pShardInfo = &shards.shardInfos[i];
+
+    if (pShardInfo->maxIdDigits > pInfo->maxIdDigits) {
+      pInfo->maxIdDigits = pShardInfo->maxIdDigits;
+    }
+    if (pShardInfo->maxLinksDigits > pInfo->maxLinksDigits) {
+      pInfo->maxLinksDigits = pShardInfo->maxLinksDigits;
+    }
+    if (pShardInfo->maxSizeDigits > pInfo->maxSizeDigits) {
+      pInfo->maxSizeDigits = pShardInfo->maxSizeDigits;
+    }
+    if (pShardInfo->maxUserLetters > pInfo->maxUserLetters) {
+      pInfo->maxUserLetters = pShardInfo->maxUserLetters;
+    }
+    if (pShardInfo->maxGroupLetters > pInfo->maxGroupLetters) {
+      pInfo->maxGroupLetters = pShardInfo->maxGroupLetters;
+    }
+    pInfo->hasSpecialCharacters = pInfo->hasSpecialCharacters || pShardInfo->hasSpecialCharacters;
+  }
+
+  Shard_run(shardsLength, printShard, &shards);
+
+  for (int i = 0; i < shardsLength; i++) {
+    Output_write(out, shards.outputs[i].data, shards.outputs[i].length);
+    Output_free(&shards.outputs[i]);
+  }
+
+  free(shards.shardInfos);
+  free(shards.outputs);
+  return;
+}
+
+// Gets the metadata of every entry in a directory
+// Without the -l, -i, -S, -t, --du or --format options only the file type is needed
+// With the --io-uring option, large directories are statted with batches of asynchronous requests
+// Large directories are statted in inode order unless the --no-inode-order option is used
+// If shardsLength is more than 1, the entries are split into that many shards that are statted on their own threads
+// If pUsage is not NULL, the entries are added to the disk usage of their directory
+static void statEntries(int directoryFd, int entriesLength, FileEntry* entries, Usage* pUsage, int shardsLength, Options* pOptions) {
+  bool isTypeOnly = Details_isTypeOnly(pOptions);
+
+  if (shardsLength > 1) {
+    DirectoryShards shards = {directoryFd, entriesLength, entries, shardsLength, isTypeOnly, pOptions};
+    Shard_run(shardsLength, statShard, &shards);
+  } else {
+    fetchEntries(directoryFd, entriesLength, entries, isTypeOnly, pOptions);
+  }
+
+  if (pUsage != NULL) {
+    Usage_addEntries(pUsage, entriesLength, entries);
+  }
 
-// Print the file name
-// Prints using single quotes when the file name contains special characters
-// Prints using double quotes when the file name contains single quotes
-static void printFilename(char* filename, bool addExtraSpace) {
-  char singleQuote = '\'';
-  char* findSingleQuote = strchr(filename, singleQuote);
+  return;
+}
 
-  if (findSingleQuote == NULL) {
-    char* specialCharacters = " !$^&()`\"";
-    char* findSpecialCharacters = strpbrk(filename, specialCharacters);
+// Gets the device of an open directory when the -x option is used, which its subdirectories must be on to be listed
+// Returns 0 if the option is not used
+static dev_t getDirectoryDevice(int directoryFd, Options* pOptions) {
+  struct stat directoryStatBuffer;
+
+  if (!pOptions->oneFileSystemOption || fstat(directoryFd, &directoryStatBuffer) == -1) {
+    return 0;
+  }
 
-    if (findSpecialCharacters == NULL) {
-      if (addExtraSpace) {
-        printf(" %s", filename);
+  return directoryStatBuffer.st_dev;
+}
+
+// Checks whether a statted entry is a subdirectory that the -R option descends into
+// With the -x option, subdirectories on a different device than their parent directory are skipped
+static bool isDescended(FileEntry* pEntry, dev_t directoryDevice, Options* pOptions) {
+  if (!pOptions->recursiveOption || !S_ISDIR(pEntry->statBuffer.st_mode)) {
+    return false;
+  }
+
+  return !pOptions->oneFileSystemOption || directoryDevice == 0 || pEntry->statBuffer.st_dev == directoryDevice;
+}
+
+// Lists the contents of an open directory stream to out in directory order, without sorting (-U)
+// Entries are read, statted and printed a window at a time, so memory use does not grow with the directory
+// Column widths are computed separately for each window
+// If pTopHeap is not NULL, entries are offered to the heap instead of being printed (--top)
+// They are named by their path inside directoryPath, unless it is NULL
+// If pUsage is not NULL, the entries are added to the disk usage of the directory (--du)
+// Sets the length and array pointer for the names of its subdirectories if the -R option is set
+// The subdirectory names are allocated from pArena and stay valid until the arena is freed
+// directories array must eventually be freed
+static void streamDirectory(Output* out, DIR* directoryStream, Arena* pArena, TopHeap* pTopHeap, char* directoryPath, Usage* pUsage, Options* pOptions, int* pDirectoriesLength, char*** pDirectories) {
+  int directoryFd = dirfd(directoryStream);
+  dev_t directoryDevice = getDirectoryDevice(directoryFd, pOptions);
+  FileEntry* entries = malloc(sizeof(FileEntry) * STREAM_WINDOW_LENGTH);
+  int directoriesLength = 0;
+  int directoriesCapacity = 0;
+  char** directories = NULL;
+  bool isEndOfDirectory = false;
+
+  while (!isEndOfDirectory) {
+    // Read the next window of entries, with names in an arena that only lives for the window
+    Arena windowArena;
+    Arena_init(&windowArena);
+    int entriesLength = 0;
+    long startTime = Stats_start();
+
+    while (entriesLength < STREAM_WINDOW_LENGTH) {
+      struct dirent* pDirectoryEntry = Directory_readVisibleEntry(directoryStream);
+
+      if (pDirectoryEntry == NULL) {
+        isEndOfDirectory = true;
+        break;
+      }
+
+      int nameLength = strlen(pDirectoryEntry->d_name);
+
+      if (pPruner != NULL && Prune_isExcluded(pPruner, pDirectoryEntry->d_name, nameLength)) {
+        continue;
+      }
+
+      entries[entriesLength].name = Arena_copyString(&windowArena, pDirectoryEntry->d_name, nameLength);
+      entries[entriesLength].nameLength = nameLength;
+      entries[entriesLength].type = Directory_getEntryType(pDirectoryEntry);
+      entries[entriesLength].inode = pDirectoryEntry->d_ino;
+      entriesLength++;
+    }
+
+    Stats_stop(STATS_READ, entriesLength, startTime);
+    Stats_addEntries(entriesLength);
+    statEntries(directoryFd, entriesLength, entries, pUsage, 1, pOptions);
+
+    startTime = Stats_start();
+    FileGroupInfo fileGroupInfo;
+    if (pTopHeap == NULL) {
+      Details_getGroupInfo(entriesLength, entries, pOptions, &fileGroupInfo);
+    }
+
+    for (int i = 0; i < entriesLength; i++) {
+      if (pTopHeap == NULL) {
+        Details_printEntry(out, &entries[i], directoryFd, &fileGroupInfo, pOptions);
       } else {
-        printf("%s", filename);
+        Top_offer(pTopHeap, &entries[i], directoryPath);
+      }
+
+      // If the -R option is set, keep the names of subdirectories beyond this window
+      if (isDescended(&entries[i], directoryDevice, pOptions)) {
+        if (directoriesLength == directoriesCapacity) {
+          directoriesCapacity = (directoriesCapacity == 0) ? INITIAL_ARRAY_CAPACITY : directoriesCapacity * 2;
+          directories = realloc(directories, sizeof(char*) * directoriesCapacity);
+        }
+
+        directories[directoriesLength] = Arena_copyString(pArena, entries[i].name, entries[i].nameLength);
+        directoriesLength++;
       }
-    } else {
-      printf("'%s'", filename);
     }
-  } else {
-    printf("\"%s\"", filename);
+
+    Stats_stop(STATS_FORMAT, entriesLength, startTime);
+
+    // Print each window as soon as it is formatted
+    if (pTopHeap == NULL) {
+      Output_flush(out);
+    }
+    Arena_free(&windowArena);
   }
 
+  free(entries);
+  entries = NULL;
+
+  *pDirectoriesLength = directoriesLength;
+  *pDirectories = directories;
   return;
 }
 
-// Prints out the details of a file or directory file
-static void printFileDetails(char* filename, char* filePath, struct stat statBuffer, FileGroupInfo* pInfo, Options* pOptions) {
-  char modeBuffer[MODE_STRING_LENGTH];
-  char dateBuffer[DATE_STRING_LENGTH];
-  char symbolicBuffer[PATH_MAX];
-
-  // If the -i option is used, print the index number of the file
-  if (pOptions->indexOption) {
-    printf("%*ld ", pInfo->maxIdDigits, statBuffer.st_ino);
-  }
-
-  // If the -l option is used, Print the mode, # of hard links, user, group,
-  // size, and last modified date of the file
-  if (pOptions->longOption) {
-    printf(
-      "%s %*ld %-*s %-*s %*ld %s ",
-      Helpers_parseMode(statBuffer.st_mode, modeBuffer),
-      pInfo->maxLinksDigits,
-      statBuffer.st_nlink,
-      pInfo->maxUserLetters,
-      Helpers_getUserName(statBuffer.st_uid),
-      pInfo->maxGroupLetters,
-      Helpers_getGroupName(statBuffer.st_gid),
-      pInfo->maxSizeDigits,
-      statBuffer.st_size,
-      Helpers_parseDate(statBuffer.st_mtime, dateBuffer)
-    );
-  }
-
-  // Print the file name
-  // Prints using single quotes when the file name contains special characters
-  // Prints using double quotes when the file name contains single quotes
-  printFilename(filename, pInfo->hasSpecialCharacters);
-
-  // If the file is a symbolic link, print the file name that it points to
-  if (pOptions->longOption && S_ISLNK(statBuffer.st_mode)) {
-    int linkLength = readlink(filePath, symbolicBuffer, PATH_MAX);
-
-    if (linkLength != -1) {
-      int terminateIndex = (linkLength < PATH_MAX) ? linkLength : PATH_MAX - 1;
-      symbolicBuffer[terminateIndex] = '\0';
-      printf(" -> ");
-      printFilename(symbolicBuffer, false);
+// Lists the contents of an open directory stream to out
+// Filenames are allocated from pArena
+// If pUsage is not NULL, the entries are added to the disk usage of the directory (--du)
+// A large directory is statted, measured and formatted on up to jobsCount threads
+// Sets the length and array pointer for the names of its subdirectories if the -R option is set
+// The subdirectory names stay valid until the arena is freed
+// directories array must eventually be freed
+static void listDirectory(Output* out, DIR* directoryStream, Arena* pArena, Usage* pUsage, int jobsCount, Options* pOptions, int* pDirectoriesLength, char*** pDirectories) {
+  if (pOptions->unsortedOption) {
+    streamDirectory(out, directoryStream, pArena, NULL, NULL, pUsage, pOptions, pDirectoriesLength, pDirectories);
+    return;
+  }
+
+  int directoryFd = dirfd(directoryStream);
+  int entriesLength = 0;
+  FileEntry* entries = NULL;
+
+  // If the --index option is used, get the sorted filenames of an unchanged directory from the index
+  struct stat directoryStatBuffer;
+  bool hasDirectoryStat = pMetadataIndex != NULL && fstat(directoryFd, &directoryStatBuffer) == 0;
+  bool isIndexed = hasDirectoryStat && Index_find(pMetadataIndex, &directoryStatBuffer, &entriesLength, &entries);
+
+  if (!isIndexed) {
+    // Get the filenames of all files/subdirectories in the directory in a single pass
+    long startTime = Stats_start();
+    entriesLength = Directory_readEntries(directoryStream, pArena, pPruner, &entries);
+    Stats_stop(STATS_READ, entriesLength, startTime);
+
+    startTime = Stats_start();
+    Sort_lexicographicalSort(entriesLength, entries);
+    Stats_stop(STATS_SORT, 1, startTime);
+  } else if (pPruner != NULL) {
+    // Names read from the directory are excluded as they are read, but indexed names are not
+    entriesLength = excludeEntries(entriesLength, entries);
+  }
+
+  Stats_addEntries(entriesLength);
+
+  int directoriesLength = 0;
+  char** directories = NULL;
+
+  if (pOptions->recursiveOption) {
+    directories = malloc(sizeof(char*) * entriesLength);
+  }
+
+  // Get the metadata of every file/subdirectory once
+  int shardsLength = Shard_getShardsLength(entriesLength, jobsCount);
+  statEntries(directoryFd, entriesLength, entries, pUsage, shardsLength, pOptions);
+
+  // Only complete directories are recorded, so a later listing without --exclude can use them
+  if (hasDirectoryStat && pPruner == NULL) {
+    Index_record(pMetadataIndex, &directoryStatBuffer, entriesLength, entries);
+  }
+
+  // If the -S or -t option is used, reorder the entries now that their metadata is known
+  if (pOptions->sortOrder != SORT_NAME) {
+    long startTime = Stats_start();
+    Sort_orderEntries(entriesLength, entries, pOptions->sortOrder);
+    Stats_stop(STATS_SORT, 1, startTime);
+  }
+
+  // Get information about the group of files/subdirectories, and print out the details of each file
+  // according to what options are set
+  long startTime = Stats_start();
+
+  if (shardsLength > 1) {
+    printShardedEntries(out, directoryFd, entriesLength, entries, shardsLength, pOptions);
+  } else {
+    FileGroupInfo fileGroupInfo;
+    Details_getGroupInfo(entriesLength, entries, pOptions, &fileGroupInfo);
+
+    for (int i = 0; i < entriesLength; i++) {
+      Details_printEntry(out, &entries[i], directoryFd, &fileGroupInfo, pOptions);
     }
   }
 
-  printf("\n");
+  dev_t directoryDevice = getDirectoryDevice(directoryFd, pOptions);
+
+  for (int i = 0; i < entriesLength; i++) {
+    // If the -R option is set, create an array of all subdirectories
+    if (isDescended(&entries[i], directoryDevice, pOptions)) {
+      directories[directoriesLength] = entries[i].name;
+      directoriesLength++;
+    }
+  }
+
+  Stats_stop(STATS_FORMAT, entriesLength, startTime);
+
+  free(entries);
+  entries = NULL;
+
+  *pDirectoriesLength = directoriesLength;
+  *pDirectories = directories;
+  return;
+}
+
+// Prints the best entries kept in a heap, best first, and empties the heap
+// directoryFd is the directory that the entry names are relative to (or AT_FDCWD for paths)
+static void printTopEntries(TopHeap* pHeap, int directoryFd, Options* pOptions) {
+  int entriesLength;
+  FileEntry* entries;
+  long startTime = Stats_start();
+  Top_takeEntries(pHeap, &entriesLength, &entries);
+  Stats_stop(STATS_SORT, 1, startTime);
+
+  startTime = Stats_start();
+  FileGroupInfo fileGroupInfo;
+  Details_getGroupInfo(entriesLength, entries, pOptions, &fileGroupInfo);
+
+  for (int i = 0; i < entriesLength; i++) {
+    Details_printEntry(&standardOutput, &entries[i], directoryFd, &fileGroupInfo, pOptions);
+  }
+
+  Stats_stop(STATS_FORMAT, entriesLength, startTime);
+  Top_freeEntries(entriesLength, entries);
+  return;
+}
+
+// Reports the disk usage of a directory of a traversal once all of its subdirectories have been summed,
+// and adds it to the usage of its parent, which is the deepest directory left on the stack
+// The directory path is the first pathLength bytes of the walk path
+static void finishTraversalUsage(Traversal* pTraversal, size_t pathLength, Usage* pUsage) {
+  DirectoryWalk* pWalk = &pTraversal->walk;
+  Usage_addLine(&usageReport, pWalk->path.data, pathLength, pWalk->framesLength, pUsage);
+
+  if (pWalk->framesLength > 0) {
+    Usage_merge(pWalk->frames[pWalk->framesLength - 1].pData, pUsage);
+  }
+
+  Usage_free(pUsage);
   return;
 }
 
-// Iterates through a directory, calling a function for every file/subdirectory
-// This called function will be passed the current index, the current directory entry, and pArgument
-// Skips the '.' and '..' directories
-// directoryStream must be an open directory stream
-// Subsequent calls to iterateDirectory must first call rewinddir on the directory stream
-// Returns the size of the directory (# of files/subdirectories inside)
-typedef void (*ITERATE_FUNCTION)(int index, struct dirent* pDirectoryEntry, void* pArgument);
-static int iterateDirectory(DIR* directoryStream, ITERATE_FUNCTION pIterateFunction, void* pArgument) {
-  int length = 0;
-  struct dirent* pDirectoryEntry;
-
-  while (true) {
-    pDirectoryEntry = readdir(directoryStream);
-
-    if (pDirectoryEntry == NULL) {
-      break;
+// Lists a directory of a traversal, whose path has been set in the walk path buffer
+// If it has subdirectories to print with the -R option, it is pushed onto the walk stack with their names
+// Otherwise it is closed right away
+// name is the directory name relative to its parent, and must stay valid until the directory is popped
+static void enterTraversalDirectory(Traversal* pTraversal, DIR* directoryStream, char* name) {
+  Options* pOptions = pTraversal->pOptions;
+  DirectoryWalk* pWalk = &pTraversal->walk;
+
+  if (directoryStream == NULL) {
+    Details_printError(&standardOutput, "list: cannot open directory '", pWalk->path.data, "': Permission denied\n", pOptions);
+    return;
+  }
+
+  // The arena only lives until the subdirectory names are packed, so entry names are never held during descent
+  Arena arena;
+  Arena_init(&arena);
+  int directoriesLength = 0;
+  char** directories = NULL;
+  Stats_addDirectory(pWalk->framesLength);
+
+  // If the --du option is used, the disk usage of the directory starts with its own metadata
+  Usage usage;
+  Usage* pUsage = NULL;
+  struct stat directoryStatBuffer;
+
+  if (pOptions->usageOption) {
+    bool hasDirectoryStat = fstat(dirfd(directoryStream), &directoryStatBuffer) == 0;
+    Usage_init(&usage, hasDirectoryStat ? &directoryStatBuffer : NULL);
+    pUsage = &usage;
+  }
+
+  // If the --top option is used, entries are kept in the heap instead of being printed
+  // With -R the best entries of every subdirectory are ranked together, so they are named by their paths
+  if (pOptions->topCount > 0) {
+    char* directoryPath = pOptions->recursiveOption ? pWalk->path.data : NULL;
+    streamDirectory(&standardOutput, directoryStream, &arena, &pTraversal->topHeap, directoryPath, pUsage, pOptions, &directoriesLength, &directories);
+
+    if (!pOptions->recursiveOption) {
+      printTopEntries(&pTraversal->topHeap, dirfd(directoryStream), pOptions);
     }
+  } else {
+    listDirectory(&standardOutput, directoryStream, &arena, pUsage, pOptions->jobsCount, pOptions, &directoriesLength, &directories);
+  }
 
-    if (pDirectoryEntry->d_name[0] == '.') {
-      continue;
+  // Directories are entered in depth-first order, so hard linked files are counted where they are first found
+  if (pUsage != NULL) {
+    Usage_countLinks(pUsage, &usageReport);
+  }
+
+  // If the --max-depth option is used, subdirectories below the deepest level are never opened
+  if (pWalk->framesLength == pOptions->maxDepth) {
+    directoriesLength = 0;
+  }
+
+  if (directoriesLength == 0) {
+    if (pUsage != NULL) {
+      finishTraversalUsage(pTraversal, pWalk->path.length, pUsage);
     }
 
-    if (pIterateFunction != NULL) {
-      (*pIterateFunction)(length, pDirectoryEntry, pArgument);
+    free(directories);
+    Arena_free(&arena);
+
+    if (!Directory_closeWalk(pWalk, directoryStream)) {
+      Details_printError(&standardOutput, "list: could not close directory", "", "\n", pOptions);
     }
+    return;
+  }
+
+  // The usage of a pushed directory is summed as its subdirectories are popped
+  Usage* pFrameUsage = NULL;
 
-    length++;
+  if (pUsage != NULL) {
+    pFrameUsage = malloc(sizeof(Usage));
+    *pFrameUsage = usage;
   }
 
-  return length;
+  Directory_pushWalk(pWalk, directoryStream, name, directoriesLength, directories, pFrameUsage);
+
+  free(directories);
+  Arena_free(&arena);
+  return;
 }
 
-// Records the filename from a directory entry into a string array
-// Passed as an argument to iterateDirectory
-static void recordFilename(int index, struct dirent* pDirectoryEntry, void* pArgument) {
-  char** filenames = pArgument;
+// Pops the deepest directory of a traversal once all of its subdirectories have been printed
+static void popTraversalFrame(Traversal* pTraversal) {
+  size_t pathLength;
+  void* pData;
 
-  filenames[index] = malloc(NAME_MAX);
-  strncpy(filenames[index], pDirectoryEntry->d_name, NAME_MAX);
+  if (!Directory_popWalk(&pTraversal->walk, &pathLength, &pData)) {
+    Details_printError(&standardOutput, "list: could not close directory", "", "\n", pTraversal->pOptions);
+  }
+
+  if (pData != NULL) {
+    finishTraversalUsage(pTraversal, pathLength, pData);
+    free(pData);
+  }
 
   return;
 }
 
 // Prints out the contents of a directory
 // The calling function is responsible for printing out the directory name if needed
-// If -R option is set, also recursively prints all subdirectories
+// If -R option is set, also prints all subdirectories in depth-first order, with a walk that keeps at most
+// openLimit directories open
+// With the --top option and -R, only the best entries of the directory and all of its subdirectories are printed,
+// as a single list of paths once the traversal is done
 static void printDirectory(char* directoryPath, Options* pOptions) {
-  int status = 0;
-  DIR* directoryStream = opendir(directoryPath);
+  Traversal traversal;
+  traversal.pOptions = pOptions;
+  Top_init(&traversal.topHeap, pOptions->topCount, pOptions->sortOrder);
+
+  DIR* directoryStream = Directory_startWalk(&traversal.walk, directoryPath, pOptions->openLimit);
+  enterTraversalDirectory(&traversal, directoryStream, directoryPath);
+
+  while (traversal.walk.framesLength > 0) {
+    char* name = Directory_nextWalk(&traversal.walk);
+
+    if (name == NULL) {
+      popTraversalFrame(&traversal);
+      continue;
+    }
+
+    if (pOptions->topCount == 0) {
+      printDirectoryName(&standardOutput, traversal.walk.path.data, true, pOptions);
+    }
+
+    enterTraversalDirectory(&traversal, Directory_openWalk(&traversal.walk, name), name);
+  }
+
+  if (pOptions->topCount > 0 && pOptions->recursiveOption) {
+    printTopEntries(&traversal.topHeap, AT_FDCWD, pOptions);
+  }
+
+  Top_free(&traversal.topHeap);
+  Directory_freeWalk(&traversal.walk);
+  return;
+}
+
+// Closes the directory stream of a task once it is no longer needed
+// Must be called while holding the task lock
+static void closeTaskDirectory(DirectoryTask* pTask) {
+  if (closedir(pTask->directoryStream) == -1) {
+    pTask->hasCloseError = true;
+  }
+  pTask->directoryStream = NULL;
+  openTasksLength--;
+
+  return;
+}
+
+// Opens the directory of a task relative to its parent directory
+// If the parent was closed to stay within the open limit, each directory between the task and its nearest open
+// ancestor (or the working directory) is opened by name in turn, so the path length is never limited by PATH_MAX
+// Returns NULL if the directory could not be opened
+static DIR* openTaskDirectory(DirectoryTask* pTask) {
+  DirectoryTask* pParent = pTask->pParent;
+
+  // The parent is either closed for good, or kept open until this task has opened its directory
+  if (pParent == NULL) {
+    return Directory_open(AT_FDCWD, pTask->name);
+  } else if (pParent->directoryStream != NULL) {
+    return Directory_open(dirfd(pParent->directoryStream), pTask->name);
+  }
+
+  // Other ancestors can be closed at any time, so the nearest open one is duplicated while holding the task lock
+  pthread_mutex_lock(&taskLock);
+  DirectoryTask* pAncestor = pParent;
+
+  while (pAncestor != NULL && pAncestor->directoryStream == NULL) {
+    pAncestor = pAncestor->pParent;
+  }
+
+  int fd = (pAncestor == NULL) ? AT_FDCWD : dup(dirfd(pAncestor->directoryStream));
+  pthread_mutex_unlock(&taskLock);
+
+  // The directories from the ancestor down to the task, which are opened in that order
+  int chainLength = pTask->depth - ((pAncestor == NULL) ? -1 : pAncestor->depth);
+  DirectoryTask** chain = malloc(sizeof(DirectoryTask*) * chainLength);
+  DirectoryTask* pChainTask = pTask;
+
+  for (int i = chainLength - 1; i >= 0; i--) {
+    chain[i] = pChainTask;
+    pChainTask = pChainTask->pParent;
+  }
+
+  for (int i = 0; i < chainLength && fd != -1; i++) {
+    int nextFd = openat(fd, chain[i]->name, O_RDONLY | O_DIRECTORY);
+
+    if (fd != AT_FDCWD) {
+      close(fd);
+    }
+
+    fd = nextFd;
+  }
+
+  free(chain);
+
+  if (fd == -1) {
+    return NULL;
+  }
+
+  DIR* directoryStream = fdopendir(fd);
 
   if (directoryStream == NULL) {
-    printf("list: cannot open directory '%s': Permission denied\n", directoryPath);
-    return;
+    close(fd);
   }
 
-  // Count the number of files/subdirectories in the directory
-  int filenamesLength = iterateDirectory(directoryStream, NULL, NULL);
-  int directoriesLength = 0;
+  return directoryStream;
+}
+
+// Lists the directory of a task into its output buffer and submits a task for each subdirectory
+// Pass workerIndex as -1 when listing from outside the pool
+static void listDirectoryTask(Pool* pPool, int workerIndex, DirectoryTask* pTask) {
+  DirectoryTask* pParent = pTask->pParent;
 
-  char** filenames = malloc(sizeof(char*) * filenamesLength);
+  pTask->directoryStream = openTaskDirectory(pTask);
+
+  // Release the parent directory once this directory no longer needs it to be open
+  pthread_mutex_lock(&taskLock);
+  if (pTask->directoryStream != NULL) {
+    openTasksLength++;
+  }
+  if (pParent != NULL) {
+    pParent->openChildrenLength--;
+    if (pParent->openChildrenLength == 0 && pParent->directoryStream != NULL) {
+      closeTaskDirectory(pParent);
+    }
+  }
+  pthread_mutex_unlock(&taskLock);
+
+  Output* out = &pTask->output;
+  Output_initMemory(out);
+  int directoriesLength = 0;
   char** directories = NULL;
 
-  if (pOptions->recursiveOption) {
-    directories = malloc(sizeof(char*) * filenamesLength);
+  // If the --du option is used, the disk usage of the directory starts with its own metadata
+  // Hard linked files are counted later, when the task is printed in depth-first order
+  Usage* pUsage = NULL;
+  struct stat directoryStatBuffer;
+  Usage_init(&pTask->usage, NULL);
+
+  if (pTask->directoryStream != NULL && pTask->pOptions->usageOption) {
+    if (fstat(dirfd(pTask->directoryStream), &directoryStatBuffer) == 0) {
+      Usage_init(&pTask->usage, &directoryStatBuffer);
+    }
+    pUsage = &pTask->usage;
   }
 
-  rewinddir(directoryStream);
+  if (pTask->directoryStream == NULL) {
+    Details_printError(out, "list: cannot open directory '", pTask->path, "': Permission denied\n", pTask->pOptions);
+  } else {
+    Stats_addDirectory(pTask->depth);
+    listDirectory(out, pTask->directoryStream, &pTask->arena, pUsage, 1, pTask->pOptions, &directoriesLength, &directories);
+  }
 
-  // Get the filenames of all files/subdirectories in the directory
-  iterateDirectory(directoryStream, recordFilename, filenames);
+  // If the --max-depth option is used, subdirectories below the deepest level are never opened
+  if (pTask->depth == pTask->pOptions->maxDepth) {
+    directoriesLength = 0;
+  }
 
-  Sort_lexicographicalSort(filenamesLength, filenames);
+  // Create a task for each subdirectory, which will be printed in order after this directory
+  DirectoryTask** children = malloc(sizeof(DirectoryTask*) * directoriesLength);
 
-  // Get information about the group of files/subdirectories
-  FileGroupInfo fileGroupInfo;
-  getFileGroupInfo(filenamesLength, filenames, directoryPath, &fileGroupInfo);
+  for (int i = 0; i < directoriesLength; i++) {
+    children[i] = createDirectoryTask(pTask, directories[i], getPath(&pTask->arena, directories[i], pTask->path), pTask->pOptions);
+  }
+  free(directories);
+  directories = NULL;
 
-  for (int i = 0; i < filenamesLength; i++) {
-    struct stat statBuffer;
+  // The directory is kept open for its subdirectories unless more than the open limit would stay open, and they
+  // are then opened by name from an open ancestor instead
+  pthread_mutex_lock(&taskLock);
+  pTask->childrenLength = directoriesLength;
+  pTask->children = children;
+  pTask->openChildrenLength = directoriesLength;
+  if (pTask->directoryStream != NULL && (directoriesLength == 0 || openTasksLength > pTask->pOptions->openLimit)) {
+    closeTaskDirectory(pTask);
+  }
+  pthread_mutex_unlock(&taskLock);
+
+  // Submit the subdirectories in reverse so that this worker continues with the first one
+  // They are submitted before the task is done, since the printing thread may list and free them once it is
+  for (int i = directoriesLength - 1; i >= 0; i--) {
+    Pool_submit(pPool, workerIndex, children[i]);
+  }
 
-    // Get the path for each file/subdirectory
-    char* filePath = getPath(filenames[i], directoryPath);
+  pthread_mutex_lock(&taskLock);
+  pTask->isDone = true;
+  pthread_cond_broadcast(&taskDone);
+  pthread_mutex_unlock(&taskLock);
+  return;
+}
 
-    lstat(filePath, &statBuffer);
+// Lists the directory of a task taken from a pool queue, once there is room for more unprinted output
+// Tasks that the printing thread started while they were queued are skipped, and freed if they were also printed
+// Passed as an argument to Pool_create
+static void runDirectoryTask(Pool* pPool, int workerIndex, void* pArgument) {
+  DirectoryTask* pTask = pArgument;
 
-    // Print out the details of the file according to what options are set
-    printFileDetails(filenames[i], filePath, statBuffer, &fileGroupInfo, pOptions);
+  pthread_mutex_lock(&taskLock);
+  while (!pTask->isStarted && unprintedTasksLength >= unprintedTasksLimit) {
+    pthread_cond_wait(&taskPrinted, &taskLock);
+  }
 
-    free(filePath);
-    filePath = NULL;
+  // The printing thread may free the task once it is taken, so it is only marked as taken once the worker is done
+  // reading it here
+  bool isStartedElsewhere = pTask->isStarted;
+  bool isPrinted = pTask->isPrinted;
+  pTask->isTaken = true;
 
+  if (!isStartedElsewhere) {
+    pTask->isStarted = true;
+    unprintedTasksLength++;
+  }
+  pthread_mutex_unlock(&taskLock);
 
-    // If the -R option is set, create an array of all subdirectories
-    if (pOptions->recursiveOption && S_ISDIR(statBuffer.st_mode)) {
-      directories[directoriesLength] = filenames[i];
-      directoriesLength++;
-    } else {
-      free(filenames[i]);
+  if (isStartedElsewhere) {
+    if (isPrinted) {
+      free(pTask);
     }
-    filenames[i] = NULL;
+    return;
+  }
+
+  listDirectoryTask(pPool, workerIndex, pTask);
+  return;
+}
+
+// Prints out the output of a directory task and all of its subdirectory tasks in depth-first order
+// Lists a task itself if no worker has started it yet, and otherwise waits for the worker to finish it
+// Since the tasks it waits for have already started, they finish even when the workers are waiting for room
+// With the --du option, the partial disk usage summed by each worker is merged bottom-up as the tasks are printed,
+// and the total of the task is added to pParentUsage (NULL for command line arguments)
+// Frees the task and all of its subdirectory tasks, except those still in a pool queue
+static void printDirectoryTask(Pool* pPool, DirectoryTask* pTask, Usage* pParentUsage) {
+  pthread_mutex_lock(&taskLock);
+  bool isStartedHere = !pTask->isStarted;
+
+  if (isStartedHere) {
+    pTask->isStarted = true;
+    unprintedTasksLength++;
+  }
+  pthread_mutex_unlock(&taskLock);
+
+  if (isStartedHere) {
+    listDirectoryTask(pPool, -1, pTask);
   }
 
-  free(filenames);
-  filenames = NULL;
+  pthread_mutex_lock(&taskLock);
+  while (!pTask->isDone) {
+    pthread_cond_wait(&taskDone, &taskLock);
+  }
+  pthread_mutex_unlock(&taskLock);
+
+  Output_write(&standardOutput, pTask->output.data, pTask->output.length);
+  Output_free(&pTask->output);
 
-  status = closedir(directoryStream);
-  directoryStream = NULL;
+  pthread_mutex_lock(&taskLock);
+  unprintedTasksLength--;
+  pthread_cond_broadcast(&taskPrinted);
+  pthread_mutex_unlock(&taskLock);
 
-  if (status == -1) {
-    printf("list: could not close directory\n");
+  // Tasks are printed in depth-first order, so hard linked files are counted where a single thread finds them first
+  bool isUsageSummed = pTask->pOptions->usageOption;
+  if (isUsageSummed) {
+    Usage_countLinks(&pTask->usage, &usageReport);
   }
 
-  // If -R option is set, recursively print all subdirectories
-  if (pOptions->recursiveOption) {
-    for (int i = 0; i < directoriesLength; i++) {
-      char* childDirectoryPath = getPath(directories[i], directoryPath);
+  for (int i = 0; i < pTask->childrenLength; i++) {
+    printDirectoryName(&standardOutput, pTask->children[i]->path, true, pTask->pOptions);
+    printDirectoryTask(pPool, pTask->children[i], &pTask->usage);
+  }
 
-      printf("\n%s:\n", childDirectoryPath);
-      printDirectory(childDirectoryPath, pOptions);
+  if (isUsageSummed) {
+    Usage_addLine(&usageReport, pTask->path, strlen(pTask->path), pTask->depth, &pTask->usage);
 
-      free(childDirectoryPath);
-      childDirectoryPath = NULL;
+    if (pParentUsage != NULL) {
+      Usage_merge(pParentUsage, &pTask->usage);
     }
+  }
 
-    Helpers_freeStringArray(directoriesLength, directories);
-    directories = NULL;
+  // All subdirectories have been opened, so the directory stream has been closed
+  if (pTask->hasCloseError) {
+    Details_printError(&standardOutput, "list: could not close directory", "", "\n", pTask->pOptions);
   }
 
+  Usage_free(&pTask->usage);
+  free(pTask->children);
+  Arena_free(&pTask->arena);
+
+  pthread_mutex_lock(&taskLock);
+  pTask->isPrinted = true;
+  bool isTaken = pTask->isTaken;
+  pthread_mutex_unlock(&taskLock);
+
+  if (isTaken) {
+    free(pTask);
+  }
   return;
 }
 
 // Gets the array of filenames from the command line arguments
 // Sets the length of the filenames array and sets the pointer to the filenames array
-void Files_getFilenames(int argc, char* argv[], int* filenamesLengthAddress, char*** filenamesAddress) {
-  char** filenames = argv + 1;
-  int filenamesLength = argc - 1;
-
+void Files_getFilenames(int argc, char* argv[], Options* pOptions, int* filenamesLengthAddress, char*** filenamesAddress) {
   // Move array pointer to the first file name argument
-  while (filenamesLength && filenames[0][0] == '-') {
-    filenames++;
-    filenamesLength--;
-  }
+  char** filenames = argv + 1 + pOptions->argumentsLength;
+  int filenamesLength = argc - 1 - pOptions->argumentsLength;
 
   *filenamesLengthAddress = filenamesLength;
   *filenamesAddress = filenames;
@@ -396,6 +1020,26 @@ void Files_getFilenames(int argc, char* argv[], int* filenamesLengthAddress, cha
 
 // List all files and directories from the provided filename arguments
 void Files_list(int filenamesLength, char** filenames, Options* pOptions) {
+  if (pOptions->statsOption) {
+    Stats_enable();
+  }
+
+  Output_initFile(&standardOutput, STDOUT_FILENO);
+  standardOutput.isCounted = true;
+  Record_writeHeader(&standardOutput, pOptions->format);
+
+  if (pOptions->indexPath != NULL && !pOptions->watchOption) {
+    pMetadataIndex = Index_open(pOptions->indexPath);
+  }
+
+  if (pOptions->usageOption) {
+    Usage_initReport(&usageReport, pOptions->usageDepth);
+  }
+
+  if (pOptions->excludePatternsLength > 0) {
+    pPruner = Prune_compile(pOptions->excludePatternsLength, pOptions->excludePatterns);
+  }
+
   // Use current directory as default if no file arguments are provided
   char* defaultFilenames[] = {"."};
   if (filenamesLength == 0) {
@@ -406,8 +1050,8 @@ void Files_list(int filenamesLength, char** filenames, Options* pOptions) {
   // Separate the filename arguments into directories and files
   int directoriesLength = 0;
   int filesLength = 0;
-  char** directories;
-  char** files;
+  FileEntry* directories;
+  FileEntry* files;
   separateFilesAndDirectories(
     filenamesLength, filenames,
     &directoriesLength, &directories,
@@ -415,48 +1059,126 @@ void Files_list(int filenamesLength, char** filenames, Options* pOptions) {
     pOptions
   );
 
+  // If the --watch option is used, keep listing a single directory as it changes
+  if (pOptions->watchOption) {
+    if (filenamesLength == 1 && directoriesLength == 1) {
+      Watch_run(&standardOutput, directories[0].name, pOptions);
+    } else if (filenamesLength != 1 || filesLength == 1) {
+      Output_writeString(&standardOutput, "list: --watch requires a single directory\n");
+    }
+
+    free(files);
+    free(directories);
+    Output_free(&standardOutput);
+    Stats_print();
+    return;
+  }
+
   // Sort and print all the files
   if (filesLength > 0) {
-    FileGroupInfo fileGroupInfo;
-    getFileGroupInfo(filesLength, files, NULL, &fileGroupInfo);
+    if (!pOptions->unsortedOption) {
+      Sort_lexicographicalSort(filesLength, files);
+      Sort_orderEntries(filesLength, files, pOptions->sortOrder);
+    }
 
-    Sort_lexicographicalSort(filesLength, files);
+    // If the --top option is used, only print the best files
+    if (pOptions->topCount > 0 && filesLength > pOptions->topCount) {
+      filesLength = pOptions->topCount;
+    }
+
+    FileGroupInfo fileGroupInfo;
+    Details_getGroupInfo(filesLength, files, pOptions, &fileGroupInfo);
 
     for (int i = 0; i < filesLength; i++) {
-      struct stat statBuffer;
-      lstat(files[i], &statBuffer);
-      printFileDetails(files[i], files[i], statBuffer, &fileGroupInfo, pOptions);
+      Details_printEntry(&standardOutput, &files[i], AT_FDCWD, &fileGroupInfo, pOptions);
     }
   }
 
-  Helpers_freeStringArray(filesLength, files);
+  free(files);
   files = NULL;
 
+  if (!pOptions->unsortedOption) {
+    Sort_lexicographicalSort(directoriesLength, directories);
+    Sort_orderEntries(directoriesLength, directories, pOptions->sortOrder);
+  }
+
+  // If the -j option is used with -R, list the directories on a pool of threads
+  // Each command line directory is submitted up front, and printed in order as it finishes
+  // The best entries for the --top option are kept in a single heap, so it always uses one thread
+  // If no thread can be started, the directories are walked by this thread instead
+  Pool* pPool = NULL;
+  DirectoryTask** tasks = NULL;
+
+  if (pOptions->recursiveOption && pOptions->jobsCount > 1 && pOptions->topCount == 0 && directoriesLength > 0) {
+    unprintedTasksLimit = pOptions->jobsCount * UNPRINTED_TASKS_PER_JOB;
+    pPool = Pool_create(pOptions->jobsCount, runDirectoryTask);
+  }
+
+  if (pPool != NULL) {
+    tasks = malloc(sizeof(DirectoryTask*) * directoriesLength);
+
+    for (int i = 0; i < directoriesLength; i++) {
+      tasks[i] = createDirectoryTask(NULL, directories[i].name, directories[i].name, pOptions);
+      Pool_submit(pPool, -1, tasks[i]);
+    }
+  }
+
   // Sort and print all the directories
   if (directoriesLength > 0) {
     if (filenamesLength == 1) {
-      if (pOptions->recursiveOption) {
-        printf("%s:\n", directories[0]);
+      // Records always name their directory, so that every entry record can be placed
+      if (pOptions->recursiveOption || pOptions->format != FORMAT_TEXT) {
+        printDirectoryName(&standardOutput, directories[0].name, false, pOptions);
       }
 
-      printDirectory(directories[0], pOptions);
-    } else {
-      Sort_lexicographicalSort(directoriesLength, directories);
+      if (pPool != NULL) {
+        printDirectoryTask(pPool, tasks[0], NULL);
+      } else {
+        printDirectory(directories[0].name, pOptions);
+      }
 
+      if (pOptions->usageOption) {
+        Usage_printReport(&usageReport, &standardOutput);
+      }
+    } else {
       for (int i = 0; i < directoriesLength; i++) {
-        if (i != 0 || filesLength != 0) {
-          printf("\n");
-        }
+        printDirectoryName(&standardOutput, directories[i].name, i != 0 || filesLength != 0, pOptions);
 
-        printf("%s:\n", directories[i]);
+        if (pPool != NULL) {
+          printDirectoryTask(pPool, tasks[i], NULL);
+        } else {
+          printDirectory(directories[i].name, pOptions);
+        }
 
-        printDirectory(directories[i], pOptions);
+        if (pOptions->usageOption) {
+          Usage_printReport(&usageReport, &standardOutput);
+        }
       }
     }
   }
 
-  Helpers_freeStringArray(directoriesLength, directories);
+  if (pPool != NULL) {
+    Pool_destroy(pPool);
+    pPool = NULL;
+    free(tasks);
+    tasks = NULL;
+  }
+
+  free(directories);
   directories = NULL;
 
+  if (pMetadataIndex != NULL) {
+    Index_close(pMetadataIndex);
+    pMetadataIndex = NULL;
+  }
+
+  if (pPruner != NULL) {
+    Prune_free(pPruner);
+    pPruner = NULL;
+  }
+
+  Usage_freeReport(&usageReport);
+  Output_free(&standardOutput);
+  Stats_print();
   return;
 }
@@ -4,8 +4,9 @@
 #include "options.h"
 
 // Gets the array of filenames from the command line arguments
+// Skips over the arguments taken up by options
 // Sets the length of the filenames array and sets the pointer to the filenames array
-void Files_getFilenames(int argc, char* argv[], int* filenamesLengthAddress, char*** filenamesAddress);
+void Files_getFilenames(int argc, char* argv[], Options* pOptions, int* filenamesLengthAddress, char*** filenamesAddress);
 
 // List all files and directories from the provided filename arguments
 void Files_list(int filenamesLength, char** filenames, Options* pOptions);
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include <limits.h>
 #include <math.h>
 #include <sys/types.h>
@@ -11,7 +12,183 @@
 #include <grp.h>
 #include <pwd.h>
 #include <time.h>
+#include <pthread.h>
 #include "helpers.h"
+#include "stats.h"
+
+// The # of seconds in a day without a DST change
+#define SECONDS_PER_DAY 86400
+
+// The length of the day part of a formatted date ("Mmm dd yyyy ")
+#define DAY_STRING_LENGTH 12
+
+// The # of formatted days each thread caches
+#define DATE_CACHE_DAYS 8
+
+// The states of a formatted day in a date cache
+typedef enum {
+  DAY_UNCHECKED, // Only one timestamp has fallen in the day, so its UTC offset has not been checked yet
+  DAY_VALID, // Every second of the day has the same UTC offset, so its dates are formatted from the cached day
+  DAY_INVALID // The day has a DST change, so its dates are always formatted with localtime_r and strftime
+} DayState;
+
+// A formatted day
+typedef struct {
+  DayState state; // Whether dates on the day can be formatted from the cached day
+  time_t dayStart; // The timestamp of the first second of the day, assuming its UTC offset never changes
+  int year; // The year of the day, as in tm_year
+  int month; // The month of the day, as in tm_mon
+  int dayOfMonth; // The day of the month, as in tm_mday
+  char dayString[DAY_STRING_LENGTH]; // The formatted day, without its null terminator
+} CachedDay;
+
+// The most recently formatted days, kept separately by each thread
+typedef struct {
+  int daysLength; // The # of cached days
+  int nextDay; // The index of the day replaced when another day is cached
+  CachedDay days[DATE_CACHE_DAYS]; // The cached days, in no particular order
+} DateCache;
+
+static pthread_key_t dateCacheKey;
+static pthread_once_t dateCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createDateCacheKey() {
+  pthread_key_create(&dateCacheKey, free);
+  return;
+}
+
+// Initial # of slots in a name cache
+#define INITIAL_NAME_CACHE_CAPACITY 64
+
+// A user or group name stored in a name cache
+typedef struct {
+  bool isUsed; // The slot holds a name
+  unsigned id; // The user or group ID
+  int nameLength; // The length of the name
+  char* name; // The name, which is never freed once cached
+} NameCacheSlot;
+
+// An open addressing hash table mapping user or group IDs to names
+typedef struct {
+  pthread_rwlock_t lock; // Allows concurrent lookups, and a single thread adding names
+  int capacity; // The # of slots, always a power of 2
+  int length; // The # of used slots
+  NameCacheSlot* slots; // The slots, probed linearly from the hashed ID
+  long hits; // The # of lookups answered by the cache
+  long misses; // The # of lookups that went to the group or password database
+} NameCache;
+
+// Looks up the name for an ID in the group or password database
+// Returned string must eventually be freed
+typedef char* (*LOOKUP_FUNCTION)(unsigned id);
+
+static NameCache userCache = {PTHREAD_RWLOCK_INITIALIZER, 0, 0, NULL, 0, 0};
+static NameCache groupCache = {PTHREAD_RWLOCK_INITIALIZER, 0, 0, NULL, 0, 0};
+
+// Finds the slot for an ID, which is either the slot holding the ID or the empty slot where it belongs
+// The cache must have at least one slot
+static NameCacheSlot* findSlot(NameCacheSlot* slots, int capacity, unsigned id) {
+  unsigned index = (id * 2654435761u) & (capacity - 1);
+
+  while (slots[index].isUsed && slots[index].id != id) {
+    index = (index + 1) & (capacity - 1);
+  }
+
+  return &slots[index];
+}
+
+// Doubles the capacity of a name cache and moves all names into the new slots
+// Must be called while holding the write lock
+static void growNameCache(NameCache* pCache) {
+  int capacity = (pCache->capacity == 0) ? INITIAL_NAME_CACHE_CAPACITY : pCache->capacity * 2;
+  NameCacheSlot* slots = calloc(capacity, sizeof(NameCacheSlot));
+
+  for (int i = 0; i < pCache->capacity; i++) {
+    if (pCache->slots[i].isUsed) {
+      *findSlot(slots, capacity, pCache->slots[i].id) = pCache->slots[i];
+    }
+  }
+
+  free(pCache->slots);
+  pCache->slots = slots;
+  pCache->capacity = capacity;
+  return;
+}
+
+// Gets the name for an ID from a name cache, looking it up and caching it on the first request
+// Sets the length of the name
+static char* getCachedName(NameCache* pCache, unsigned id, LOOKUP_FUNCTION pLookupFunction, int* pNameLength) {
+  pthread_rwlock_rdlock(&pCache->lock);
+
+  if (pCache->capacity > 0) {
+    NameCacheSlot* pSlot = findSlot(pCache->slots, pCache->capacity, id);
+
+    if (pSlot->isUsed) {
+      __atomic_fetch_add(&pCache->hits, 1, __ATOMIC_RELAXED);
+
+      // The slots can be freed by another thread growing the cache once the lock is released
+      char* name = pSlot->name;
+      *pNameLength = pSlot->nameLength;
+      pthread_rwlock_unlock(&pCache->lock);
+      return name;
+    }
+  }
+
+  pthread_rwlock_unlock(&pCache->lock);
+  pthread_rwlock_wrlock(&pCache->lock);
+
+  // Keep the cache at most half full
+  if (2 * (pCache->length + 1) > pCache->capacity) {
+    growNameCache(pCache);
+  }
+
+  // Another thread may have added the name while the lock was released
+  NameCacheSlot* pSlot = findSlot(pCache->slots, pCache->capacity, id);
+
+  if (pSlot->isUsed) {
+    __atomic_fetch_add(&pCache->hits, 1, __ATOMIC_RELAXED);
+  } else {
+    __atomic_fetch_add(&pCache->misses, 1, __ATOMIC_RELAXED);
+    pSlot->isUsed = true;
+    pSlot->id = id;
+    long startTime = Stats_start();
+    pSlot->name = (*pLookupFunction)(id);
+    Stats_stop(STATS_NAMES, 1, startTime);
+    pSlot->nameLength = strlen(pSlot->name);
+    pCache->length++;
+  }
+
+  char* name = pSlot->name;
+  *pNameLength = pSlot->nameLength;
+  pthread_rwlock_unlock(&pCache->lock);
+  return name;
+}
+
+// Looks up a group name in the group database
+// Adapted from the provided infodemo.c
+// Returned string must eventually be freed
+static char* lookupGroupName(unsigned gid) {
+    struct group* pGroup = getgrgid(gid);
+
+    if (pGroup == NULL) {
+      return strdup(EMPTY_STRING);
+    }
+
+    return strdup(pGroup->gr_name);
+}
+
+// Looks up a user name in the password database
+// Adapted from the provided infodemo.c
+// Returned string must eventually be freed
+static char* lookupUserName(unsigned uid) {
+    struct passwd* password = getpwuid(uid);
+
+    if (password == NULL) {
+      return strdup(EMPTY_STRING);
+    }
+
+    return strdup(password->pw_name);
+}
 
 // Parse the mode integer into a formatted string
 // formattedMode must be length 11 (to hold 10 chars)
@@ -37,44 +214,136 @@ char* Helpers_parseMode(mode_t mode, char* formattedMode) {
   return formattedMode;
 }
 
-// Parse the timestamp into a formatted string
-// formattedDate must be length 18 (to hold 17 chars)
-char* Helpers_parseDate(time_t timestamp, char* dateBuffer) {
-  struct tm* time = localtime(&timestamp);
-  strftime(dateBuffer, DATE_STRING_LENGTH, "%b %e %Y %H:%M", time);
-  return dateBuffer;
+// Gets the date cache of the calling thread, creating it if needed
+static DateCache* getDateCache() {
+  pthread_once(&dateCacheKeyOnce, createDateCacheKey);
+  DateCache* pCache = pthread_getspecific(dateCacheKey);
+
+  if (pCache == NULL) {
+    pCache = calloc(1, sizeof(DateCache));
+    pthread_setspecific(dateCacheKey, pCache);
+  }
+
+  return pCache;
 }
 
-// Get the group name from the group ID
-// Adapted from the provided infodemo.c
-char* Helpers_getGroupName(gid_t gid) {
-    struct group* pGroup = getgrgid(gid);
+// Finds the cached day that a timestamp falls in
+// Returns NULL if the day is not cached
+static CachedDay* findCachedDay(DateCache* pCache, time_t timestamp) {
+  for (int i = 0; i < pCache->daysLength; i++) {
+    CachedDay* pDay = &pCache->days[i];
 
-    if (pGroup == NULL) {
-      return EMPTY_STRING;
+    // A single unsigned comparison, since timestamps before the day wrap around to huge values
+    if ((unsigned long long) (timestamp - pDay->dayStart) < SECONDS_PER_DAY) {
+      return pDay;
     }
+  }
 
-    return pGroup->gr_name;
+  return NULL;
 }
 
-// Get the user name from the user ID
-// Adapted from the provided infodemo.c
-char* Helpers_getUserName(uid_t uid) {
-    struct passwd* password = getpwuid(uid);
+// Formats a timestamp with localtime_r and strftime, and caches its day
+// Years without exactly 4 digits are never cached
+static void formatUncachedDate(DateCache* pCache, time_t timestamp, char* dateBuffer) {
+  struct tm time;
+  localtime_r(&timestamp, &time);
+  strftime(dateBuffer, DATE_STRING_LENGTH, "%b %e %Y %H:%M", &time);
 
-    if (password == NULL) {
-      return EMPTY_STRING;
-    }
+  if (time.tm_year < 1000 - 1900 || time.tm_year > 9999 - 1900) {
+    return;
+  }
+
+  CachedDay* pDay = &pCache->days[pCache->nextDay];
+  pCache->nextDay = (pCache->nextDay + 1) % DATE_CACHE_DAYS;
+
+  if (pCache->daysLength < DATE_CACHE_DAYS) {
+    pCache->daysLength++;
+  }
 
-    return password->pw_name;
+  pDay->state = DAY_UNCHECKED;
+  pDay->dayStart = timestamp - (time.tm_hour * 3600 + time.tm_min * 60 + time.tm_sec);
+  pDay->year = time.tm_year;
+  pDay->month = time.tm_mon;
+  pDay->dayOfMonth = time.tm_mday;
+  memcpy(pDay->dayString, dateBuffer, DAY_STRING_LENGTH);
+  return;
 }
 
-// Frees an array of strings
-void Helpers_freeStringArray(int length, char** stringArray) {
-  for (int i = 0; i < length; i++) {
-    free(stringArray[i]);
+// Checks whether every second of a cached day has the same UTC offset, which holds exactly when local midnight
+// before and after it are where they would be without a DST change (including 30 minute shifts)
+// Only done once a second timestamp falls in the day, so timestamps on many different days are not slowed down
+static void checkCachedDay(CachedDay* pDay) {
+  struct tm time;
+  memset(&time, 0, sizeof(struct tm));
+  time.tm_year = pDay->year;
+  time.tm_mon = pDay->month;
+  time.tm_mday = pDay->dayOfMonth;
+  time.tm_isdst = -1;
+
+  bool isValid = mktime(&time) == pDay->dayStart;
+
+  memset(&time, 0, sizeof(struct tm));
+  time.tm_year = pDay->year;
+  time.tm_mon = pDay->month;
+  time.tm_mday = pDay->dayOfMonth + 1;
+  time.tm_isdst = -1;
+
+  pDay->state = (isValid && mktime(&time) == pDay->dayStart + SECONDS_PER_DAY) ? DAY_VALID : DAY_INVALID;
+  return;
+}
+
+// Parse the timestamp into a formatted string
+// formattedDate must be length 18 (to hold 17 chars)
+// The last few formatted days are cached, so only the hour and minute are computed for other times on those days
+char* Helpers_parseDate(time_t timestamp, char* dateBuffer) {
+  DateCache* pCache = getDateCache();
+  CachedDay* pDay = findCachedDay(pCache, timestamp);
+
+  if (pDay == NULL) {
+    formatUncachedDate(pCache, timestamp, dateBuffer);
+    return dateBuffer;
+  }
+
+  if (pDay->state == DAY_UNCHECKED) {
+    checkCachedDay(pDay);
+  }
+
+  if (pDay->state == DAY_INVALID) {
+    struct tm time;
+    localtime_r(&timestamp, &time);
+    strftime(dateBuffer, DATE_STRING_LENGTH, "%b %e %Y %H:%M", &time);
+    return dateBuffer;
   }
-  free(stringArray);
 
+  int secondsIntoDay = timestamp - pDay->dayStart;
+  int hour = secondsIntoDay / 3600;
+  int minute = secondsIntoDay / 60 % 60;
+
+  memcpy(dateBuffer, pDay->dayString, DAY_STRING_LENGTH);
+  dateBuffer[DAY_STRING_LENGTH] = '0' + hour / 10;
+  dateBuffer[DAY_STRING_LENGTH + 1] = '0' + hour % 10;
+  dateBuffer[DAY_STRING_LENGTH + 2] = ':';
+  dateBuffer[DAY_STRING_LENGTH + 3] = '0' + minute / 10;
+  dateBuffer[DAY_STRING_LENGTH + 4] = '0' + minute % 10;
+  dateBuffer[DAY_STRING_LENGTH + 5] = '\0';
+  return dateBuffer;
+}
+
+// Get the group name from the group ID
+// Sets the length of the group name
+char* Helpers_getGroupName(gid_t gid, int* pNameLength) {
+  return getCachedName(&groupCache, gid, lookupGroupName, pNameLength);
+}
+
+// Get the user name from the user ID
+// Sets the length of the user name
+char* Helpers_getUserName(uid_t uid, int* pNameLength) {
+  return getCachedName(&userCache, uid, lookupUserName, pNameLength);
+}
+
+// Gets the # of user and group name lookups answered by the cache, and the # that were not
+void Helpers_getNameCacheCounts(long* pHits, long* pMisses) {
+  *pHits = __atomic_load_n(&userCache.hits, __ATOMIC_RELAXED) + __atomic_load_n(&groupCache.hits, __ATOMIC_RELAXED);
+  *pMisses = __atomic_load_n(&userCache.misses, __ATOMIC_RELAXED) + __atomic_load_n(&groupCache.misses, __ATOMIC_RELAXED);
   return;
 }
@@ -1,6 +1,7 @@
 // Provides several helper functions
 #ifndef _HELPERS_H_
 #define _HELPERS_H_
+#include <sys/types.h>
 
 #define MODE_STRING_LENGTH 11
 #define DATE_STRING_LENGTH 18
@@ -15,12 +16,18 @@ char* Helpers_parseMode(mode_t mode, char* formattedMode);
 char* Helpers_parseDate(time_t timestamp, char* dateBuffer);
 
 // Get the group name from the group ID
-char* Helpers_getGroupName(gid_t gid);
+// Sets the length of the group name
+// Names are cached after the first lookup, and the returned string must not be freed
+// Safe to call from multiple threads
+char* Helpers_getGroupName(gid_t gid, int* pNameLength);
 
 // Get the user name from the user ID
-char* Helpers_getUserName(uid_t uid);
+// Sets the length of the user name
+// Names are cached after the first lookup, and the returned string must not be freed
+// Safe to call from multiple threads
+char* Helpers_getUserName(uid_t uid, int* pNameLength);
 
-// Frees an array of strings
-void Helpers_freeStringArray(int length, char** stringArray);
+// Gets the # of user and group name lookups answered by the cache, and the # that were not
+void Helpers_getNameCacheCounts(long* pHits, long* pMisses);
 
 #endif
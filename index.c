@@ -0,0 +1,374 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "entry.h"
+#include "output.h"
+#include "index.h"
+
+// Identifies an index file and its layout version
+#define INDEX_MAGIC "LISTIDX1"
+#define INDEX_MAGIC_LENGTH 8
+
+// Directories modified this many seconds before the listing started are not recorded
+#define RACY_SECONDS 2
+
+// Initial # of directories the table of a new index can hold before growing
+#define INITIAL_TABLE_CAPACITY 256
+
+// The index file starts with a header, followed by one record per directory, and ends with a
+// table of all records sorted by device and inode number
+// Every record and the table start at a multiple of 8 bytes
+typedef struct {
+  char magic[INDEX_MAGIC_LENGTH]; // Always INDEX_MAGIC
+  uint64_t tableLength; // The # of directories in the table
+  uint64_t tableOffset; // The offset of the table from the start of the file
+  uint64_t fileLength; // The length of the whole file
+} IndexHeader;
+
+// The start of a directory record, which is followed by its entries
+// Each entry is a 2 byte name length, a 2 byte file type (st_mode >> 12) and the null terminated name
+typedef struct {
+  uint64_t device; // The device number of the directory
+  uint64_t inode; // The inode number of the directory
+  int64_t modificationSeconds; // The modification time of the directory
+  int64_t modificationNanoseconds;
+  int64_t changeSeconds; // The change time of the directory
+  int64_t changeNanoseconds;
+  uint32_t entriesLength; // The # of entries in the directory
+  uint32_t dataLength; // The # of bytes taken by the entries
+} RecordHeader;
+
+// A table entry locating the record of a directory
+typedef struct {
+  uint64_t device; // The device number of the directory
+  uint64_t inode; // The inode number of the directory
+  uint64_t offset; // The offset of the record from the start of the file
+} TableEntry;
+
+struct Index {
+  char* path; // The path of the index file
+  char* oldData; // The mapped contents of the existing index, or NULL if there is none
+  size_t oldLength; // The length of the mapped contents
+  TableEntry* oldTable; // The table of the existing index
+  uint64_t oldTableLength; // The # of directories in the existing index
+  char* newPath; // The unique path the new index is written to before replacing the existing one
+  Output newOutput; // Buffers the records of the new index
+  uint64_t newLength; // The # of bytes written to the new index
+  TableEntry* newTable; // The table of the new index, in the order records were written
+  uint64_t newTableLength; // The # of directories in the new index
+  uint64_t newTableCapacity; // The # of directories the new table can hold before it must grow
+  time_t startTime; // When the index was opened
+  pthread_mutex_t lock; // Protects the new index
+};
+
+static int compareTableEntries(const void* a, const void* b) {
+  const TableEntry* pA = a;
+  const TableEntry* pB = b;
+
+  if (pA->device != pB->device) {
+    return (pA->device < pB->device) ? -1 : 1;
+  }
+
+  if (pA->inode != pB->inode) {
+    return (pA->inode < pB->inode) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+// Finds a directory in a table sorted by device and inode number
+// Returns NULL if the directory is not in the table
+static TableEntry* findTableEntry(TableEntry* table, uint64_t tableLength, uint64_t device, uint64_t inode) {
+  TableEntry key = {device, inode, 0};
+  return bsearch(&key, table, tableLength, sizeof(TableEntry), compareTableEntries);
+}
+
+// Maps the existing index file into memory and checks its layout
+// Leaves the old index empty if the file is missing or invalid
+static void mapOldIndex(Index* pIndex) {
+  int fd = open(pIndex->path, O_RDONLY);
+
+  if (fd == -1) {
+    return;
+  }
+
+  struct stat statBuffer;
+
+  if (fstat(fd, &statBuffer) == -1 || statBuffer.st_size < (off_t) sizeof(IndexHeader)) {
+    close(fd);
+    return;
+  }
+
+  char* data = mmap(NULL, statBuffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return;
+  }
+
+  IndexHeader header;
+  memcpy(&header, data, sizeof(IndexHeader));
+
+  bool isValid = memcmp(header.magic, INDEX_MAGIC, INDEX_MAGIC_LENGTH) == 0 &&
+    header.fileLength == (uint64_t) statBuffer.st_size &&
+    header.tableOffset % 8 == 0 &&
+    header.tableOffset <= header.fileLength &&
+    (header.fileLength - header.tableOffset) / sizeof(TableEntry) == header.tableLength;
+
+  if (!isValid) {
+    munmap(data, statBuffer.st_size);
+    return;
+  }
+
+  pIndex->oldData = data;
+  pIndex->oldLength = statBuffer.st_size;
+  pIndex->oldTable = (TableEntry*) (data + header.tableOffset);
+  pIndex->oldTableLength = header.tableLength;
+  return;
+}
+
+// Reads the header of a record in the old index
+// Returns false if the record does not fit before the table
+static bool readOldRecordHeader(Index* pIndex, uint64_t offset, RecordHeader* pHeader) {
+  uint64_t tableOffset = (char*) pIndex->oldTable - pIndex->oldData;
+
+  if (offset > tableOffset || tableOffset - offset < sizeof(RecordHeader)) {
+    return false;
+  }
+
+  memcpy(pHeader, pIndex->oldData + offset, sizeof(RecordHeader));
+  return pHeader->dataLength <= tableOffset - offset - sizeof(RecordHeader);
+}
+
+// Writes bytes to the new index
+static void writeNewIndex(Index* pIndex, const void* data, size_t length) {
+  Output_write(&pIndex->newOutput, data, length);
+  pIndex->newLength += length;
+  return;
+}
+
+// Pads the new index with zeros up to the next multiple of 8 bytes
+static void alignNewIndex(Index* pIndex) {
+  char padding[8] = {0};
+  writeNewIndex(pIndex, padding, (8 - pIndex->newLength % 8) % 8);
+  return;
+}
+
+// Adds a directory to the table of the new index
+// Must be called while holding the index lock
+static void addNewTableEntry(Index* pIndex, uint64_t device, uint64_t inode, uint64_t offset) {
+  if (pIndex->newTableLength == pIndex->newTableCapacity) {
+    pIndex->newTableCapacity = (pIndex->newTableCapacity == 0) ? INITIAL_TABLE_CAPACITY : pIndex->newTableCapacity * 2;
+    pIndex->newTable = realloc(pIndex->newTable, sizeof(TableEntry) * pIndex->newTableCapacity);
+  }
+
+  pIndex->newTable[pIndex->newTableLength].device = device;
+  pIndex->newTable[pIndex->newTableLength].inode = inode;
+  pIndex->newTable[pIndex->newTableLength].offset = offset;
+  pIndex->newTableLength++;
+  return;
+}
+
+// Opens the index stored at path, mapping it into memory
+Index* Index_open(char* path) {
+  Index* pIndex = calloc(1, sizeof(Index));
+
+  pIndex->path = path;
+  pIndex->startTime = time(NULL);
+  pthread_mutex_init(&pIndex->lock, NULL);
+  mapOldIndex(pIndex);
+
+  // Write the new index next to the existing one, so it can replace it in a single rename
+  // Each run gets a file of its own, so runs sharing an index never write into the same file
+  pIndex->newPath = malloc(strlen(path) + sizeof(".XXXXXX"));
+  strcpy(pIndex->newPath, path);
+  strcat(pIndex->newPath, ".XXXXXX");
+
+  // If the new index cannot be written, the existing one is still used but left unchanged
+  int fd = mkstemp(pIndex->newPath);
+
+  if (fd != -1) {
+    fchmod(fd, 0644);
+  }
+
+  if (fd == -1) {
+    Output_initMemory(&pIndex->newOutput);
+  } else {
+    Output_initFile(&pIndex->newOutput, fd);
+  }
+
+  // Reserve space for the header, which is written once the table is known
+  IndexHeader header;
+  memset(&header, 0, sizeof(IndexHeader));
+  writeNewIndex(pIndex, &header, sizeof(IndexHeader));
+
+  return pIndex;
+}
+
+// Finds the recorded entries of a directory, identified by its device and inode numbers
+bool Index_find(Index* pIndex, struct stat* pDirectoryStatBuffer, int* pEntriesLength, FileEntry** pEntries) {
+  if (pIndex->oldData == NULL) {
+    return false;
+  }
+
+  TableEntry* pTableEntry = findTableEntry(pIndex->oldTable, pIndex->oldTableLength, pDirectoryStatBuffer->st_dev, pDirectoryStatBuffer->st_ino);
+  RecordHeader header;
+
+  if (pTableEntry == NULL || !readOldRecordHeader(pIndex, pTableEntry->offset, &header)) {
+    return false;
+  }
+
+  bool isCurrent = header.modificationSeconds == pDirectoryStatBuffer->st_mtim.tv_sec &&
+    header.modificationNanoseconds == pDirectoryStatBuffer->st_mtim.tv_nsec &&
+    header.changeSeconds == pDirectoryStatBuffer->st_ctim.tv_sec &&
+    header.changeNanoseconds == pDirectoryStatBuffer->st_ctim.tv_nsec;
+  char* data = pIndex->oldData + pTableEntry->offset + sizeof(RecordHeader);
+  char* dataEnd = data + header.dataLength;
+
+  if (!isCurrent) {
+    return false;
+  }
+
+  FileEntry* entries = malloc(sizeof(FileEntry) * header.entriesLength);
+
+  for (uint32_t i = 0; i < header.entriesLength; i++) {
+    uint16_t nameLength;
+    uint16_t type;
+
+    if (dataEnd - data < 4) {
+      free(entries);
+      return false;
+    }
+
+    memcpy(&nameLength, data, sizeof(uint16_t));
+    memcpy(&type, data + 2, sizeof(uint16_t));
+    data += 4;
+
+    if (dataEnd - data < nameLength + 1 || data[nameLength] != '\0') {
+      free(entries);
+      return false;
+    }
+
+    entries[i].name = data;
+    entries[i].nameLength = nameLength;
+    entries[i].type = (mode_t) type << 12;
+    entries[i].inode = 0;
+    data += nameLength + 1;
+  }
+
+  *pEntriesLength = header.entriesLength;
+  *pEntries = entries;
+  return true;
+}
+
+// Records the sorted entries of a directory in the new index
+void Index_record(Index* pIndex, struct stat* pDirectoryStatBuffer, int entriesLength, FileEntry* entries) {
+  if (pIndex->newOutput.fd == -1) {
+    return;
+  }
+
+  if (pDirectoryStatBuffer->st_mtim.tv_sec >= pIndex->startTime - RACY_SECONDS ||
+      pDirectoryStatBuffer->st_ctim.tv_sec >= pIndex->startTime - RACY_SECONDS) {
+    return;
+  }
+
+  RecordHeader header;
+  memset(&header, 0, sizeof(RecordHeader));
+  header.device = pDirectoryStatBuffer->st_dev;
+  header.inode = pDirectoryStatBuffer->st_ino;
+  header.modificationSeconds = pDirectoryStatBuffer->st_mtim.tv_sec;
+  header.modificationNanoseconds = pDirectoryStatBuffer->st_mtim.tv_nsec;
+  header.changeSeconds = pDirectoryStatBuffer->st_ctim.tv_sec;
+  header.changeNanoseconds = pDirectoryStatBuffer->st_ctim.tv_nsec;
+  header.entriesLength = entriesLength;
+
+  for (int i = 0; i < entriesLength; i++) {
+    header.dataLength += 4 + entries[i].nameLength + 1;
+  }
+
+  pthread_mutex_lock(&pIndex->lock);
+
+  addNewTableEntry(pIndex, header.device, header.inode, pIndex->newLength);
+  writeNewIndex(pIndex, &header, sizeof(RecordHeader));
+
+  for (int i = 0; i < entriesLength; i++) {
+    uint16_t nameLength = entries[i].nameLength;
+    uint16_t type = (entries[i].statBuffer.st_mode & S_IFMT) >> 12;
+
+    writeNewIndex(pIndex, &nameLength, sizeof(uint16_t));
+    writeNewIndex(pIndex, &type, sizeof(uint16_t));
+    writeNewIndex(pIndex, entries[i].name, entries[i].nameLength + 1);
+  }
+
+  alignNewIndex(pIndex);
+  pthread_mutex_unlock(&pIndex->lock);
+  return;
+}
+
+// Writes the new index, carrying over the recorded directories from the old index that were not
+// listed again, then unmaps and frees the index
+void Index_close(Index* pIndex) {
+  if (pIndex->newOutput.fd != -1) {
+    // Records of directories listed in this run are looked up in the new table
+    qsort(pIndex->newTable, pIndex->newTableLength, sizeof(TableEntry), compareTableEntries);
+    uint64_t listedLength = pIndex->newTableLength;
+
+    for (uint64_t i = 0; i < pIndex->oldTableLength; i++) {
+      TableEntry* pOldEntry = &pIndex->oldTable[i];
+
+      if (findTableEntry(pIndex->newTable, listedLength, pOldEntry->device, pOldEntry->inode) != NULL) {
+        continue;
+      }
+
+      RecordHeader header;
+
+      if (!readOldRecordHeader(pIndex, pOldEntry->offset, &header)) {
+        continue;
+      }
+
+      addNewTableEntry(pIndex, pOldEntry->device, pOldEntry->inode, pIndex->newLength);
+      writeNewIndex(pIndex, pIndex->oldData + pOldEntry->offset, sizeof(RecordHeader) + header.dataLength);
+      alignNewIndex(pIndex);
+    }
+
+    qsort(pIndex->newTable, pIndex->newTableLength, sizeof(TableEntry), compareTableEntries);
+
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, INDEX_MAGIC_LENGTH);
+    header.tableLength = pIndex->newTableLength;
+    header.tableOffset = pIndex->newLength;
+    header.fileLength = pIndex->newLength + pIndex->newTableLength * sizeof(TableEntry);
+
+    writeNewIndex(pIndex, pIndex->newTable, pIndex->newTableLength * sizeof(TableEntry));
+    Output_flush(&pIndex->newOutput);
+
+    if (pwrite(pIndex->newOutput.fd, &header, sizeof(IndexHeader), 0) == sizeof(IndexHeader)) {
+      rename(pIndex->newPath, pIndex->path);
+    } else {
+      unlink(pIndex->newPath);
+    }
+
+    close(pIndex->newOutput.fd);
+  }
+
+  Output_free(&pIndex->newOutput);
+
+  if (pIndex->oldData != NULL) {
+    munmap(pIndex->oldData, pIndex->oldLength);
+  }
+
+  pthread_mutex_destroy(&pIndex->lock);
+  free(pIndex->newTable);
+  free(pIndex->newPath);
+  free(pIndex);
+  return;
+}
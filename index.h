@@ -0,0 +1,33 @@
+// Handles the persistent metadata index used by the --index option
+#ifndef _INDEX_H_
+#define _INDEX_H_
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "entry.h"
+
+typedef struct Index Index;
+
+// Opens the index stored at path, mapping it into memory
+// A missing or invalid index file is treated as an empty index
+// Returned index must eventually be closed
+Index* Index_open(char* path);
+
+// Finds the recorded entries of a directory, identified by its device and inode numbers
+// Only succeeds if the directory's modification and change times match the recorded ones
+// Sets the length and array pointer for the entries, which are sorted by name and have their type set
+// Entry names point into the index and stay valid until it is closed
+// entries array must eventually be freed
+bool Index_find(Index* pIndex, struct stat* pDirectoryStatBuffer, int* pEntriesLength, FileEntry** pEntries);
+
+// Records the sorted entries of a directory in the new index
+// The statBuffer of every entry must hold at least its file type
+// Directories modified in the last few seconds are not recorded, since they could still change
+// within the same timestamp. Safe to call from multiple threads
+void Index_record(Index* pIndex, struct stat* pDirectoryStatBuffer, int entriesLength, FileEntry* entries);
+
+// Writes the new index, carrying over the recorded directories from the old index that were not
+// listed again, then unmaps and frees the index
+void Index_close(Index* pIndex);
+
+#endif
@@ -9,10 +9,12 @@ int main(int argc, char* argv[]) {
   // Get the files/directories from the command line arguments
   int filenamesLength;
   char** filenames;
-  Files_getFilenames(argc, argv, &filenamesLength, &filenames);
+  Files_getFilenames(argc, argv, &options, &filenamesLength, &filenames);
 
   // List the specified files and directories
   Files_list(filenamesLength, filenames, &options);
 
+  Options_free(&options);
+
   return 0;
 }
@@ -3,6 +3,22 @@
 #include <string.h>
 #include <stdbool.h>
 #include "options.h"
+#include "directory.h"
+
+// The largest # of threads that can be requested with -j
+#define MAX_JOBS_COUNT 1024
+
+// The largest # of entries that can be requested with --top
+#define MAX_TOP_COUNT 100000000
+
+// The deepest directory that can be requested with --du-depth
+#define MAX_USAGE_DEPTH 1000000
+
+// The deepest subdirectory that can be requested with --max-depth
+#define MAX_DEPTH 1000000
+
+// The largest # of open directories that can be requested with --max-open
+#define MAX_OPEN_LIMIT 1048576
 
 static void repeatedOptionError() {
   printf("list: cannot specify an option multiple times\n");
@@ -16,11 +32,215 @@ static void invalidOptionsError() {
   return;
 }
 
+static void invalidFormatError() {
+  printf("list: invalid output format\n");
+  exit(1);
+  return;
+}
+
+static void pruneOptionsError() {
+  printf("list: --max-depth and -x require -R\n");
+  exit(1);
+  return;
+}
+
+static void sortOptionsError() {
+  printf("list: -S, -t and -U cannot be used together, and --top cannot be used with -U\n");
+  exit(1);
+  return;
+}
+
+static void usageOptionsError() {
+  printf("list: --du requires -R, --du-depth requires --du, and neither can be used with --format\n");
+  exit(1);
+  return;
+}
+
+static void watchOptionsError() {
+  printf("list: --watch cannot be used with -R, -U, -S, -t, --format, --top or --exclude\n");
+  exit(1);
+  return;
+}
+
+static void invalidValueError(char* name, char* valueString) {
+  printf("list: invalid value '%s' for %s\n", valueString, name);
+  exit(1);
+  return;
+}
+
+// Parses the value of an integer option, which must be between min and max
+// Exits with an error naming the option if the value is not an integer in range
+static void parseIntegerOption(char* name, char* valueString, int min, int max, int* pValue) {
+  char* end;
+  long value = strtol(valueString, &end, 10);
+
+  if (*valueString == '\0' || *end != '\0' || value < min || value > max) {
+    invalidValueError(name, valueString);
+  }
+
+  *pValue = value;
+  return;
+}
+
+// Gets the value of a long option that takes a value, given as either "--name=value" or "--name value"
+// optionName is the option without its leading "--", and pArgumentIndex is the index of the option in argv
+// Moves pArgumentIndex past the value if it is the next argument
+// Returns NULL if optionName is not the named option
+static char* getLongOptionValue(char* optionName, char* name, int argc, char* argv[], int* pArgumentIndex, Options* pOptions) {
+  int nameLength = strlen(name);
+
+  if (strncmp(optionName, name, nameLength) != 0) {
+    return NULL;
+  }
+
+  if (optionName[nameLength] == '=') {
+    return optionName + nameLength + 1;
+  }
+
+  if (optionName[nameLength] != '\0') {
+    return NULL;
+  }
+
+  if (*pArgumentIndex + 1 >= argc) {
+    invalidOptionsError();
+  }
+
+  (*pArgumentIndex)++;
+  pOptions->argumentsLength++;
+  return argv[*pArgumentIndex];
+}
+
+// Parses a long option, given the option name without its leading "--"
+// pArgumentIndex is the index of the option in argv, and is moved past any value taken from the next argument
+// pHasFormatOption is set once --format is parsed, since any format (including the default) can be given
+// --exclude can be given multiple times, and each pattern is added to an array with room for every argument
+static void parseLongOption(char* optionName, int argc, char* argv[], int* pArgumentIndex, bool* pHasFormatOption, Options* pOptions) {
+  char* value;
+
+  if ((value = getLongOptionValue(optionName, "index", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (pOptions->indexPath != NULL) {
+      repeatedOptionError();
+    } else if (*value == '\0') {
+      invalidOptionsError();
+    } else {
+      pOptions->indexPath = value;
+    }
+  } else if ((value = getLongOptionValue(optionName, "format", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (*pHasFormatOption) {
+      repeatedOptionError();
+    } else if (strcmp(value, "text") == 0) {
+      pOptions->format = FORMAT_TEXT;
+    } else if (strcmp(value, "ndjson") == 0) {
+      pOptions->format = FORMAT_NDJSON;
+    } else if (strcmp(value, "binary") == 0) {
+      pOptions->format = FORMAT_BINARY;
+    } else {
+      invalidFormatError();
+    }
+    *pHasFormatOption = true;
+  } else if ((value = getLongOptionValue(optionName, "max-open", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (pOptions->openLimit != 0) {
+      repeatedOptionError();
+    } else {
+      parseIntegerOption("--max-open", value, 1, MAX_OPEN_LIMIT, &pOptions->openLimit);
+    }
+  } else if ((value = getLongOptionValue(optionName, "top", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (pOptions->topCount != 0) {
+      repeatedOptionError();
+    } else {
+      parseIntegerOption("--top", value, 1, MAX_TOP_COUNT, &pOptions->topCount);
+    }
+  } else if ((value = getLongOptionValue(optionName, "du-depth", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (pOptions->usageDepth != -1) {
+      repeatedOptionError();
+    } else {
+      parseIntegerOption("--du-depth", value, 0, MAX_USAGE_DEPTH, &pOptions->usageDepth);
+    }
+  } else if ((value = getLongOptionValue(optionName, "exclude", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (*value == '\0') {
+      invalidOptionsError();
+    }
+    if (pOptions->excludePatterns == NULL) {
+      pOptions->excludePatterns = malloc(sizeof(char*) * argc);
+    }
+    pOptions->excludePatterns[pOptions->excludePatternsLength] = value;
+    pOptions->excludePatternsLength++;
+  } else if ((value = getLongOptionValue(optionName, "max-depth", argc, argv, pArgumentIndex, pOptions)) != NULL) {
+    if (pOptions->maxDepth != -1) {
+      repeatedOptionError();
+    } else {
+      parseIntegerOption("--max-depth", value, 0, MAX_DEPTH, &pOptions->maxDepth);
+    }
+  } else if (strcmp(optionName, "one-file-system") == 0) {
+    if (pOptions->oneFileSystemOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->oneFileSystemOption = true;
+    }
+  } else if (strcmp(optionName, "du") == 0) {
+    if (pOptions->usageOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->usageOption = true;
+    }
+  } else if (strcmp(optionName, "io-uring") == 0) {
+    if (pOptions->uringOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->uringOption = true;
+    }
+  } else if (strcmp(optionName, "no-inode-order") == 0) {
+    if (!pOptions->inodeOrderOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->inodeOrderOption = false;
+    }
+  } else if (strcmp(optionName, "stats") == 0) {
+    if (pOptions->statsOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->statsOption = true;
+    }
+  } else if (strcmp(optionName, "watch") == 0) {
+    if (pOptions->watchOption) {
+      repeatedOptionError();
+    } else {
+      pOptions->watchOption = true;
+    }
+  } else {
+    invalidOptionsError();
+  }
+
+  return;
+}
+
 // Parse the command line arguments and set a struct specifying the enabled options
 void Options_parseOptions(int argc, char* argv[], Options* pOptions) {
   pOptions->indexOption = false;
   pOptions->longOption = false;
   pOptions->recursiveOption = false;
+  pOptions->unsortedOption = false;
+  pOptions->uringOption = false;
+  pOptions->inodeOrderOption = true;
+  pOptions->watchOption = false;
+  pOptions->statsOption = false;
+  pOptions->sortOrder = SORT_NAME;
+  pOptions->topCount = 0;
+  pOptions->usageOption = false;
+  pOptions->usageDepth = -1;
+  pOptions->excludePatternsLength = 0;
+  pOptions->excludePatterns = NULL;
+  pOptions->maxDepth = -1;
+  pOptions->oneFileSystemOption = false;
+  pOptions->format = FORMAT_TEXT;
+  pOptions->indexPath = NULL;
+  pOptions->jobsCount = 1;
+  pOptions->openLimit = 0;
+  pOptions->argumentsLength = 0;
+  bool hasJobsOption = false;
+  bool hasSizeOption = false;
+  bool hasTimeOption = false;
+  bool hasFormatOption = false;
 
   // Check if any options were provided
   for (int i = 1; i < argc; i++) {
@@ -31,11 +251,18 @@ void Options_parseOptions(int argc, char* argv[], Options* pOptions) {
       break;
     }
 
+    pOptions->argumentsLength++;
+
     if (optionsString[1] == '\0') {
       invalidOptionsError();
       return;
     }
 
+    if (optionsString[1] == '-') {
+      parseLongOption(optionsString + 2, argc, argv, &i, &hasFormatOption, pOptions);
+      continue;
+    }
+
     optionsString++;
     char optionLetter = *optionsString;
 
@@ -58,6 +285,49 @@ void Options_parseOptions(int argc, char* argv[], Options* pOptions) {
         } else {
           pOptions->recursiveOption = true;
         }
+      } else if (optionLetter == 'U') {
+        if (pOptions->unsortedOption) {
+          repeatedOptionError();
+        } else {
+          pOptions->unsortedOption = true;
+        }
+      } else if (optionLetter == 'S') {
+        if (hasSizeOption) {
+          repeatedOptionError();
+        } else {
+          hasSizeOption = true;
+          pOptions->sortOrder = SORT_SIZE;
+        }
+      } else if (optionLetter == 't') {
+        if (hasTimeOption) {
+          repeatedOptionError();
+        } else {
+          hasTimeOption = true;
+          pOptions->sortOrder = SORT_TIME;
+        }
+      } else if (optionLetter == 'x') {
+        if (pOptions->oneFileSystemOption) {
+          repeatedOptionError();
+        } else {
+          pOptions->oneFileSystemOption = true;
+        }
+      } else if (optionLetter == 'j') {
+        if (hasJobsOption) {
+          repeatedOptionError();
+        }
+        hasJobsOption = true;
+
+        // The # of jobs is either the rest of this argument (-j4) or the next argument (-j 4)
+        if (optionsString[1] != '\0') {
+          parseIntegerOption("-j", optionsString + 1, 1, MAX_JOBS_COUNT, &pOptions->jobsCount);
+        } else if (i + 1 < argc) {
+          i++;
+          pOptions->argumentsLength++;
+          parseIntegerOption("-j", argv[i], 1, MAX_JOBS_COUNT, &pOptions->jobsCount);
+        } else {
+          invalidOptionsError();
+        }
+        break;
       } else {
         invalidOptionsError();
       }
@@ -67,5 +337,38 @@ void Options_parseOptions(int argc, char* argv[], Options* pOptions) {
     }
   }
 
+  if (pOptions->openLimit == 0) {
+    pOptions->openLimit = Directory_getDefaultOpenLimit();
+  }
+
+  // Unsorted entries are printed as they are read, so they cannot be ordered or ranked
+  if ((hasSizeOption && hasTimeOption) || (pOptions->unsortedOption && (pOptions->sortOrder != SORT_NAME || pOptions->topCount != 0))) {
+    sortOptionsError();
+  }
+
+  // Disk usage is summed over the subdirectories that -R lists, and reported as text after the listing
+  if ((pOptions->usageOption && (!pOptions->recursiveOption || pOptions->format != FORMAT_TEXT)) || (pOptions->usageDepth != -1 && !pOptions->usageOption)) {
+    usageOptionsError();
+  }
+
+  // Subdirectories are only pruned by depth or file system while -R descends into them
+  if ((pOptions->maxDepth != -1 || pOptions->oneFileSystemOption) && !pOptions->recursiveOption) {
+    pruneOptionsError();
+  }
+
+  // A watched directory is kept in sorted order with every changed name, its subdirectories are not watched,
+  // and it is redrawn as text in full
+  if (pOptions->watchOption && (pOptions->recursiveOption || pOptions->unsortedOption || pOptions->sortOrder != SORT_NAME || pOptions->format != FORMAT_TEXT || pOptions->topCount != 0 || pOptions->excludePatternsLength != 0)) {
+    watchOptionsError();
+  }
+
+  return;
+}
+
+// Frees the memory allocated for the options
+void Options_free(Options* pOptions) {
+  free(pOptions->excludePatterns);
+  pOptions->excludePatterns = NULL;
+  pOptions->excludePatternsLength = 0;
   return;
 }
@@ -3,13 +3,48 @@
 #define _OPTIONS_H_
 #include <stdbool.h>
 
+// The ways that listings can be printed (--format)
+typedef enum {
+  FORMAT_TEXT, // Columns of text, like ls
+  FORMAT_NDJSON, // One JSON object per line for every file, directory and error
+  FORMAT_BINARY // Length prefixed records with raw metadata and name bytes
+} OutputFormat;
+
+// The orders that entries can be listed in
+typedef enum {
+  SORT_NAME, // By name, the default
+  SORT_SIZE, // By size, largest first (-S)
+  SORT_TIME // By modification time, newest first (-t)
+} SortOrder;
+
 typedef struct {
   bool indexOption;
   bool longOption;
   bool recursiveOption;
+  bool unsortedOption; // List entries in directory order as they are read (-U)
+  bool uringOption; // Fetch metadata with io_uring when available (--io-uring)
+  bool inodeOrderOption; // Stat large directories in inode order, true unless --no-inode-order is used
+  bool watchOption; // Keep the listing of a directory updated as it changes (--watch)
+  bool statsOption; // Print traversal statistics to standard error when done (--stats)
+  SortOrder sortOrder; // The order entries are listed in (-S or -t), SORT_NAME if not provided
+  int topCount; // The # of best entries listed in the sort order (--top), 0 to list every entry
+  bool usageOption; // Print the disk usage of every directory after the listing (--du)
+  int usageDepth; // The deepest directory whose disk usage is printed (--du-depth), -1 if not provided
+  int excludePatternsLength; // The # of glob patterns that entry names are excluded by (--exclude)
+  char** excludePatterns; // The glob patterns that entry names are excluded by, NULL if none are provided
+  int maxDepth; // The deepest subdirectory listed by -R (--max-depth), -1 if not provided
+  bool oneFileSystemOption; // Do not list subdirectories on other file systems with -R (-x or --one-file-system)
+  OutputFormat format; // How listings are printed (--format), FORMAT_TEXT if not provided
+  char* indexPath; // The path of the metadata index to use (--index), NULL if not provided
+  int jobsCount; // The # of threads used to list directories (-j), 1 if not provided
+  int openLimit; // The most directories kept open at a time by -R (--max-open), at most 256 if not provided
+  int argumentsLength; // The # of command line arguments taken up by options
 } Options;
 
 // Parse the command line arguments and set a struct specifying the enabled options
 void Options_parseOptions(int argv, char* argc[], Options* options);
 
+// Frees the memory allocated for the options
+void Options_free(Options* pOptions);
+
 #endif
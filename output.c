@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include "output.h"
+#include "stats.h"
+
+// The # of bytes buffered before output is flushed to a file descriptor
+#define FILE_BUFFER_CAPACITY 65536
+
+// The initial # of bytes a memory buffer can hold before growing
+#define INITIAL_MEMORY_CAPACITY 4096
+
+// The # of characters needed to write any long in decimal
+#define NUMBER_STRING_LENGTH 20
+
+// Writes all of data to the file descriptor of an output buffer, retrying after partial writes
+// Only bytes written by counted buffers are added to --stats, so writing the --index file is not
+static void writeAll(Output* pOutput, const char* data, size_t length) {
+  while (length > 0) {
+    long startTime = Stats_start();
+    ssize_t writtenLength = write(pOutput->fd, data, length);
+    Stats_stop(STATS_WRITE, 1, startTime);
+
+    if (writtenLength == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    if (pOutput->isCounted) {
+      Stats_addBytes(writtenLength);
+    }
+    data += writtenLength;
+    length -= writtenLength;
+  }
+
+  return;
+}
+
+// Makes room for at least length more bytes, by flushing a file buffer or growing a memory buffer
+static void reserve(Output* pOutput, size_t length) {
+  if (pOutput->length + length <= pOutput->capacity) {
+    return;
+  }
+
+  if (pOutput->fd != -1) {
+    Output_flush(pOutput);
+    return;
+  }
+
+  size_t capacity = pOutput->capacity;
+  while (pOutput->length + length > capacity) {
+    capacity *= 2;
+  }
+
+  pOutput->data = realloc(pOutput->data, capacity);
+  pOutput->capacity = capacity;
+  return;
+}
+
+// Initializes an output buffer that is flushed to a file descriptor with write
+void Output_initFile(Output* pOutput, int fd) {
+  pOutput->fd = fd;
+  pOutput->data = malloc(FILE_BUFFER_CAPACITY);
+  pOutput->length = 0;
+  pOutput->capacity = FILE_BUFFER_CAPACITY;
+  pOutput->isCounted = false;
+  return;
+}
+
+// Initializes an output buffer that grows in memory and is never flushed
+void Output_initMemory(Output* pOutput) {
+  pOutput->fd = -1;
+  pOutput->data = malloc(INITIAL_MEMORY_CAPACITY);
+  pOutput->length = 0;
+  pOutput->capacity = INITIAL_MEMORY_CAPACITY;
+  pOutput->isCounted = false;
+  return;
+}
+
+// Writes length bytes of data
+// Data larger than a file buffer is written straight to the file descriptor
+void Output_write(Output* pOutput, const char* data, size_t length) {
+  if (pOutput->fd != -1 && length > pOutput->capacity) {
+    Output_flush(pOutput);
+    writeAll(pOutput, data, length);
+    return;
+  }
+
+  reserve(pOutput, length);
+  memcpy(pOutput->data + pOutput->length, data, length);
+  pOutput->length += length;
+  return;
+}
+
+// Writes a null terminated string
+void Output_writeString(Output* pOutput, const char* string) {
+  Output_write(pOutput, string, strlen(string));
+  return;
+}
+
+// Writes a single character
+void Output_writeCharacter(Output* pOutput, char character) {
+  reserve(pOutput, 1);
+  pOutput->data[pOutput->length] = character;
+  pOutput->length++;
+  return;
+}
+
+// Writes a number right aligned in a field of width characters (padded with spaces)
+void Output_writeNumber(Output* pOutput, long number, int width) {
+  char digits[NUMBER_STRING_LENGTH + 1];
+  int digitsLength = 0;
+  bool isNegative = number < 0;
+  unsigned long value = isNegative ? -(unsigned long) number : (unsigned long) number;
+
+  // Write the digits backwards from the end of the buffer
+  do {
+    digits[NUMBER_STRING_LENGTH - digitsLength] = '0' + value % 10;
+    digitsLength++;
+    value /= 10;
+  } while (value > 0);
+
+  if (isNegative) {
+    digits[NUMBER_STRING_LENGTH - digitsLength] = '-';
+    digitsLength++;
+  }
+
+  int paddingLength = (width > digitsLength) ? width - digitsLength : 0;
+  reserve(pOutput, paddingLength + digitsLength);
+  memset(pOutput->data + pOutput->length, ' ', paddingLength);
+  memcpy(pOutput->data + pOutput->length + paddingLength, digits + NUMBER_STRING_LENGTH + 1 - digitsLength, digitsLength);
+  pOutput->length += paddingLength + digitsLength;
+  return;
+}
+
+// Writes a string of length characters left aligned in a field of width characters (padded with spaces)
+void Output_writePadded(Output* pOutput, const char* string, int length, int width) {
+  int paddingLength = (width > length) ? width - length : 0;
+
+  Output_write(pOutput, string, length);
+  reserve(pOutput, paddingLength);
+  memset(pOutput->data + pOutput->length, ' ', paddingLength);
+  pOutput->length += paddingLength;
+  return;
+}
+
+// Writes all buffered output to the file descriptor
+// Does nothing for memory buffers
+void Output_flush(Output* pOutput) {
+  if (pOutput->fd == -1) {
+    return;
+  }
+
+  writeAll(pOutput, pOutput->data, pOutput->length);
+  pOutput->length = 0;
+  return;
+}
+
+// Flushes and frees an output buffer
+void Output_free(Output* pOutput) {
+  Output_flush(pOutput);
+  free(pOutput->data);
+  pOutput->data = NULL;
+  pOutput->length = 0;
+  pOutput->capacity = 0;
+  return;
+}
@@ -0,0 +1,46 @@
+// Handles buffered output
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+#include <stddef.h>
+#include <stdbool.h>
+
+// A buffer that output is written to
+// Either flushes to a file descriptor in large blocks, or grows in memory until it is read
+typedef struct {
+  int fd; // The file descriptor the buffer is flushed to, or -1 for a memory buffer
+  char* data; // The buffered output
+  size_t length; // The # of bytes buffered
+  size_t capacity; // The # of bytes the buffer can hold before it must be flushed or grown
+  bool isCounted; // Whether the bytes flushed are counted by --stats, set by whoever creates the standard output buffer
+} Output;
+
+// Initializes an output buffer that is flushed to a file descriptor with write
+// Its bytes are not counted by --stats until isCounted is set
+void Output_initFile(Output* pOutput, int fd);
+
+// Initializes an output buffer that grows in memory and is never flushed
+void Output_initMemory(Output* pOutput);
+
+// Writes length bytes of data
+void Output_write(Output* pOutput, const char* data, size_t length);
+
+// Writes a null terminated string
+void Output_writeString(Output* pOutput, const char* string);
+
+// Writes a single character
+void Output_writeCharacter(Output* pOutput, char character);
+
+// Writes a number right aligned in a field of width characters (padded with spaces)
+void Output_writeNumber(Output* pOutput, long number, int width);
+
+// Writes a string of length characters left aligned in a field of width characters (padded with spaces)
+void Output_writePadded(Output* pOutput, const char* string, int length, int width);
+
+// Writes all buffered output to the file descriptor
+// Does nothing for memory buffers
+void Output_flush(Output* pOutput);
+
+// Flushes and frees an output buffer
+void Output_free(Output* pOutput);
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pool.h"
+
+// Initial # of tasks a worker queue can hold before growing
+#define INITIAL_QUEUE_CAPACITY 16
+
+// A double ended queue of tasks belonging to one worker, with its own lock
+// The owning worker takes tasks from the end, other workers steal from the start
+typedef struct {
+  pthread_mutex_t lock; // Protects the tasks of the queue
+  int start; // The index of the oldest task
+  int length; // The # of tasks in the queue
+  int capacity; // The # of tasks the queue can hold before it must grow
+  void** tasks; // The circular array of tasks
+} TaskQueue;
+
+// Information passed to each worker thread
+typedef struct {
+  Pool* pPool; // The pool the worker belongs to
+  int workerIndex; // The index of the worker within the pool
+} Worker;
+
+// Each queue has its own lock, so pushing, popping and stealing only contend with workers using the same queue
+// The pool lock is only taken by workers going to sleep when every queue is empty, and by submitters waking them
+struct Pool {
+  int workersLength; // The # of worker threads that were started
+  POOL_FUNCTION pPoolFunction; // The function run for every task
+  pthread_t* threads; // The worker threads
+  Worker* workers; // The arguments passed to each worker thread
+  TaskQueue* queues; // The task queue of each worker
+  int queuedTasks; // The total # of tasks submitted and not yet taken, only accessed with atomics
+  int sleepingLength; // The # of workers waiting for a task, only accessed with atomics
+  bool isStopping; // Set when the pool is being destroyed
+  pthread_mutex_t lock; // Protects isStopping, and is held by workers while they decide to sleep
+  pthread_cond_t taskAvailable; // Signalled when a task is submitted or the pool is stopping
+};
+
+// Adds a task to the end of a queue, growing the queue if it is full
+static void pushTask(TaskQueue* pQueue, void* pTask) {
+  if (pQueue->length == pQueue->capacity) {
+    int capacity = (pQueue->capacity == 0) ? INITIAL_QUEUE_CAPACITY : pQueue->capacity * 2;
+    void** tasks = malloc(sizeof(void*) * capacity);
+
+    for (int i = 0; i < pQueue->length; i++) {
+      tasks[i] = pQueue->tasks[(pQueue->start + i) % pQueue->capacity];
+    }
+
+    free(pQueue->tasks);
+    pQueue->tasks = tasks;
+    pQueue->capacity = capacity;
+    pQueue->start = 0;
+  }
+
+  pQueue->tasks[(pQueue->start + pQueue->length) % pQueue->capacity] = pTask;
+  pQueue->length++;
+  return;
+}
+
+// Removes the newest task from the end of a queue
+static void* popTask(TaskQueue* pQueue) {
+  pQueue->length--;
+  return pQueue->tasks[(pQueue->start + pQueue->length) % pQueue->capacity];
+}
+
+// Removes the oldest task from the start of a queue
+static void* stealTask(TaskQueue* pQueue) {
+  void* pTask = pQueue->tasks[pQueue->start];
+  pQueue->start = (pQueue->start + 1) % pQueue->capacity;
+  pQueue->length--;
+  return pTask;
+}
+
+// Takes the next task for a worker, from its own queue first and then from the other queues
+// Returns NULL if every queue is empty
+static void* takeTask(Pool* pPool, int workerIndex) {
+  for (int i = 0; i < pPool->workersLength; i++) {
+    TaskQueue* pQueue = &pPool->queues[(workerIndex + i) % pPool->workersLength];
+    void* pTask = NULL;
+
+    pthread_mutex_lock(&pQueue->lock);
+    if (pQueue->length > 0) {
+      pTask = (i == 0) ? popTask(pQueue) : stealTask(pQueue);
+    }
+    pthread_mutex_unlock(&pQueue->lock);
+
+    if (pTask != NULL) {
+      __atomic_sub_fetch(&pPool->queuedTasks, 1, __ATOMIC_SEQ_CST);
+      return pTask;
+    }
+  }
+
+  return NULL;
+}
+
+// Runs tasks until the pool is stopped and every queue is empty, sleeping whenever every queue is empty
+// A worker counts itself as sleeping before it checks for tasks, and a submitter counts its task before it checks
+// for sleeping workers, so at least one of them always sees the other and no task is left without a worker
+static void* runWorker(void* pArgument) {
+  Worker* pWorker = pArgument;
+  Pool* pPool = pWorker->pPool;
+
+  while (true) {
+    pthread_mutex_lock(&pPool->lock);
+    __atomic_add_fetch(&pPool->sleepingLength, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&pPool->queuedTasks, __ATOMIC_SEQ_CST) == 0 && !pPool->isStopping) {
+      pthread_cond_wait(&pPool->taskAvailable, &pPool->lock);
+    }
+
+    __atomic_sub_fetch(&pPool->sleepingLength, 1, __ATOMIC_SEQ_CST);
+    bool isStopping = pPool->isStopping && __atomic_load_n(&pPool->queuedTasks, __ATOMIC_SEQ_CST) == 0;
+    pthread_mutex_unlock(&pPool->lock);
+
+    if (isStopping) {
+      break;
+    }
+
+    void* pTask;
+    while ((pTask = takeTask(pPool, pWorker->workerIndex)) != NULL) {
+      (*pPool->pPoolFunction)(pPool, pWorker->workerIndex, pTask);
+    }
+  }
+
+  return NULL;
+}
+
+// Creates a pool of worker threads that run tasks with the provided function
+// Only the threads that could be started are used, and NULL is returned if none could be
+// Returned pool must eventually be destroyed
+Pool* Pool_create(int workersLength, POOL_FUNCTION pPoolFunction) {
+  Pool* pPool = malloc(sizeof(Pool));
+
+  pPool->workersLength = 0;
+  pPool->pPoolFunction = pPoolFunction;
+  pPool->threads = malloc(sizeof(pthread_t) * workersLength);
+  pPool->workers = malloc(sizeof(Worker) * workersLength);
+  pPool->queues = calloc(workersLength, sizeof(TaskQueue));
+  pPool->queuedTasks = 0;
+  pPool->sleepingLength = 0;
+  pPool->isStopping = false;
+  pthread_mutex_init(&pPool->lock, NULL);
+  pthread_cond_init(&pPool->taskAvailable, NULL);
+
+  // Workers only look at the queues once a task is submitted, so the # of started workers is set before then
+  int startedLength = 0;
+
+  for (int i = 0; i < workersLength; i++) {
+    pPool->workers[i].pPool = pPool;
+    pPool->workers[i].workerIndex = i;
+    pthread_mutex_init(&pPool->queues[i].lock, NULL);
+
+    if (pthread_create(&pPool->threads[i], NULL, runWorker, &pPool->workers[i]) != 0) {
+      pthread_mutex_destroy(&pPool->queues[i].lock);
+      break;
+    }
+    startedLength++;
+  }
+
+  pthread_mutex_lock(&pPool->lock);
+  pPool->workersLength = startedLength;
+  pthread_mutex_unlock(&pPool->lock);
+
+  if (startedLength == 0) {
+    Pool_destroy(pPool);
+    return NULL;
+  }
+
+  return pPool;
+}
+
+// Submits a task to the queue of a worker
+// Pass workerIndex as -1 when submitting from outside the pool
+// Only takes the pool lock when a worker is sleeping and must be woken
+void Pool_submit(Pool* pPool, int workerIndex, void* pTask) {
+  TaskQueue* pQueue = &pPool->queues[(workerIndex == -1) ? 0 : workerIndex];
+
+  __atomic_add_fetch(&pPool->queuedTasks, 1, __ATOMIC_SEQ_CST);
+
+  pthread_mutex_lock(&pQueue->lock);
+  pushTask(pQueue, pTask);
+  pthread_mutex_unlock(&pQueue->lock);
+
+  if (__atomic_load_n(&pPool->sleepingLength, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&pPool->lock);
+    pthread_cond_signal(&pPool->taskAvailable);
+    pthread_mutex_unlock(&pPool->lock);
+  }
+
+  return;
+}
+
+// Runs the tasks that are still queued, then stops all worker threads and frees the pool
+void Pool_destroy(Pool* pPool) {
+  pthread_mutex_lock(&pPool->lock);
+  pPool->isStopping = true;
+  pthread_cond_broadcast(&pPool->taskAvailable);
+  pthread_mutex_unlock(&pPool->lock);
+
+  for (int i = 0; i < pPool->workersLength; i++) {
+    pthread_join(pPool->threads[i], NULL);
+    pthread_mutex_destroy(&pPool->queues[i].lock);
+    free(pPool->queues[i].tasks);
+  }
+
+  pthread_mutex_destroy(&pPool->lock);
+  pthread_cond_destroy(&pPool->taskAvailable);
+  free(pPool->threads);
+  free(pPool->workers);
+  free(pPool->queues);
+  free(pPool);
+  return;
+}
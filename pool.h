@@ -0,0 +1,26 @@
+// Handles a pool of worker threads that steal tasks from each other
+#ifndef _POOL_H_
+#define _POOL_H_
+
+typedef struct Pool Pool;
+
+// Function called by a worker thread for every task it runs
+// Passed the pool and the index of the worker, so that new tasks can be submitted to the same worker
+typedef void (*POOL_FUNCTION)(Pool* pPool, int workerIndex, void* pTask);
+
+// Creates a pool of worker threads that run tasks with the provided function
+// Only the threads that could be started are used, and NULL is returned if none could be
+// Returned pool must eventually be destroyed
+Pool* Pool_create(int workersLength, POOL_FUNCTION pPoolFunction);
+
+// Submits a task to the queue of a worker
+// Pass workerIndex as -1 when submitting from outside the pool
+// Workers run their own most recently submitted task first, and steal the oldest tasks of other workers when idle
+// Every queue has its own lock, and the pool lock is only taken to wake a sleeping worker
+void Pool_submit(Pool* pPool, int workerIndex, void* pTask);
+
+// Runs the tasks that are still queued, then stops all worker threads and frees the pool
+// No more tasks may be submitted once the pool is being destroyed
+void Pool_destroy(Pool* pPool);
+
+#endif
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include "prune.h"
+
+// The ways that a compiled pattern is matched against a name
+typedef enum {
+  MATCH_NAME, // The pattern has no special characters, so the name must equal it
+  MATCH_PREFIX, // The pattern is a plain prefix followed by a single '*'
+  MATCH_SUFFIX, // The pattern is a single '*' followed by a plain suffix
+  MATCH_GLOB // Any other pattern, matched with fnmatch
+} MatchKind;
+
+// A compiled exclude pattern
+typedef struct {
+  MatchKind kind; // How the pattern is matched
+  const char* text; // The name, prefix or suffix to compare, or the whole pattern for MATCH_GLOB
+  int textLength; // The length of the text
+} Matcher;
+
+struct Pruner {
+  int matchersLength; // The # of compiled patterns
+  Matcher* matchers; // The compiled patterns, in the order they were provided
+};
+
+// Checks whether a string of length characters contains any characters that are special in a glob
+static bool hasGlobCharacters(const char* string, int length) {
+  for (int i = 0; i < length; i++) {
+    if (string[i] == '*' || string[i] == '?' || string[i] == '[' || string[i] == '\\') {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Compiles a pattern into the cheapest way of matching it
+static void compileMatcher(Matcher* pMatcher, const char* pattern) {
+  int length = strlen(pattern);
+
+  if (!hasGlobCharacters(pattern, length)) {
+    pMatcher->kind = MATCH_NAME;
+    pMatcher->text = pattern;
+    pMatcher->textLength = length;
+  } else if (length > 0 && pattern[length - 1] == '*' && !hasGlobCharacters(pattern, length - 1)) {
+    pMatcher->kind = MATCH_PREFIX;
+    pMatcher->text = pattern;
+    pMatcher->textLength = length - 1;
+  } else if (length > 0 && pattern[0] == '*' && !hasGlobCharacters(pattern + 1, length - 1)) {
+    pMatcher->kind = MATCH_SUFFIX;
+    pMatcher->text = pattern + 1;
+    pMatcher->textLength = length - 1;
+  } else {
+    pMatcher->kind = MATCH_GLOB;
+    pMatcher->text = pattern;
+    pMatcher->textLength = length;
+  }
+
+  return;
+}
+
+// Compiles glob patterns that entry names are excluded by
+// The patterns must stay valid until the pruner is freed
+Pruner* Prune_compile(int patternsLength, char** patterns) {
+  Pruner* pPruner = malloc(sizeof(Pruner));
+  pPruner->matchersLength = patternsLength;
+  pPruner->matchers = malloc(sizeof(Matcher) * patternsLength);
+
+  for (int i = 0; i < patternsLength; i++) {
+    compileMatcher(&pPruner->matchers[i], patterns[i]);
+  }
+
+  return pPruner;
+}
+
+// Checks whether an entry name matches any of the patterns of a pruner
+bool Prune_isExcluded(Pruner* pPruner, const char* name, int nameLength) {
+  for (int i = 0; i < pPruner->matchersLength; i++) {
+    Matcher* pMatcher = &pPruner->matchers[i];
+
+    switch (pMatcher->kind) {
+      case MATCH_NAME:
+        if (nameLength == pMatcher->textLength && memcmp(name, pMatcher->text, nameLength) == 0) {
+          return true;
+        }
+        break;
+      case MATCH_PREFIX:
+        if (nameLength >= pMatcher->textLength && memcmp(name, pMatcher->text, pMatcher->textLength) == 0) {
+          return true;
+        }
+        break;
+      case MATCH_SUFFIX:
+        if (nameLength >= pMatcher->textLength && memcmp(name + nameLength - pMatcher->textLength, pMatcher->text, pMatcher->textLength) == 0) {
+          return true;
+        }
+        break;
+      case MATCH_GLOB:
+        if (fnmatch(pMatcher->text, name, 0) == 0) {
+          return true;
+        }
+        break;
+    }
+  }
+
+  return false;
+}
+
+// Frees a pruner
+void Prune_free(Pruner* pPruner) {
+  free(pPruner->matchers);
+  free(pPruner);
+  return;
+}
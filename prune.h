@@ -0,0 +1,20 @@
+// Handles excluding entries by name before they are statted or opened (--exclude)
+#ifndef _PRUNE_H_
+#define _PRUNE_H_
+#include <stdbool.h>
+
+typedef struct Pruner Pruner;
+
+// Compiles glob patterns that entry names are excluded by
+// Patterns that are a plain name, a prefix followed by '*' or '*' followed by a suffix are matched
+// without fnmatch, and the rest are matched with fnmatch
+// The patterns must stay valid until the pruner is freed, and returned pruner must eventually be freed
+Pruner* Prune_compile(int patternsLength, char** patterns);
+
+// Checks whether an entry name matches any of the patterns of a pruner
+bool Prune_isExcluded(Pruner* pPruner, const char* name, int nameLength);
+
+// Frees a pruner
+void Prune_free(Pruner* pPruner);
+
+#endif
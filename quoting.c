@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "quoting.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAS_VECTOR_SCAN
+#endif
+
+// The characters that make a name printed in single quotes
+#define SPECIAL_CHARACTERS " !$^&()`\""
+
+// Scans a name for the quoting flags of its characters
+typedef int (*CLASSIFY_FUNCTION)(const char* name, int length);
+
+// The QUOTING_ flags of every byte value
+static unsigned char characterFlags[256];
+
+// The scan selected for the processor
+static CLASSIFY_FUNCTION pClassifyFunction = NULL;
+static pthread_once_t classifyFunctionOnce = PTHREAD_ONCE_INIT;
+
+// Scans length characters of a name one at a time with the flag table
+static int classifyScalar(const char* name, int length) {
+  int flags = 0;
+
+  for (int i = 0; i < length; i++) {
+    flags |= characterFlags[(unsigned char) name[i]];
+  }
+
+  return flags;
+}
+
+#ifdef HAS_VECTOR_SCAN
+// Compares 16 characters with every special character and with a single quote
+// Returns the QUOTING_ flags of the characters
+static int classifyBlock16(__m128i characters) {
+  __m128i special = _mm_cmpeq_epi8(characters, _mm_set1_epi8(' '));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('!')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('$')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('^')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('&')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('(')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8(')')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('`')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(characters, _mm_set1_epi8('"')));
+  __m128i singleQuote = _mm_cmpeq_epi8(characters, _mm_set1_epi8('\''));
+
+  return (_mm_movemask_epi8(special) != 0 ? QUOTING_SPECIAL : 0) | (_mm_movemask_epi8(singleQuote) != 0 ? QUOTING_SINGLE_QUOTE : 0);
+}
+
+// Scans a name 16 characters at a time with SSE2, which every x86-64 processor supports
+// Only whole blocks inside the name are loaded, and the remaining characters use the flag table
+static int classifySse2(const char* name, int length) {
+  int flags = 0;
+  int i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    flags |= classifyBlock16(_mm_loadu_si128((const __m128i*) (name + i)));
+  }
+
+  return flags | classifyScalar(name + i, length - i);
+}
+
+// Compares 32 characters with every special character and with a single quote
+// Returns the QUOTING_ flags of the characters
+__attribute__((target("avx2")))
+static int classifyBlock32(__m256i characters) {
+  __m256i special = _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(' '));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('!')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('$')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('^')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('&')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('(')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(')')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('`')));
+  special = _mm256_or_si256(special, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('"')));
+  __m256i singleQuote = _mm256_cmpeq_epi8(characters, _mm256_set1_epi8('\''));
+
+  return (_mm256_movemask_epi8(special) != 0 ? QUOTING_SPECIAL : 0) | (_mm256_movemask_epi8(singleQuote) != 0 ? QUOTING_SINGLE_QUOTE : 0);
+}
+
+// Scans a name 32 characters at a time with AVX2, then 16 at a time with SSE2
+__attribute__((target("avx2")))
+static int classifyAvx2(const char* name, int length) {
+  int flags = 0;
+  int i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    flags |= classifyBlock32(_mm256_loadu_si256((const __m256i*) (name + i)));
+  }
+
+  return flags | classifySse2(name + i, length - i);
+}
+#endif
+
+// Fills the flag table and selects the fastest scan the processor supports
+// The LIST_QUOTING_SCAN environment variable ("scalar", "sse2" or "avx2") selects a slower scan instead,
+// so every scan can be checked against the others (make check)
+static void selectClassifyFunction() {
+  for (const char* pCharacter = SPECIAL_CHARACTERS; *pCharacter != '\0'; pCharacter++) {
+    characterFlags[(unsigned char) *pCharacter] = QUOTING_SPECIAL;
+  }
+  characterFlags['\''] = QUOTING_SINGLE_QUOTE;
+
+  pClassifyFunction = classifyScalar;
+
+  const char* scan = getenv("LIST_QUOTING_SCAN");
+
+  if (scan != NULL && strcmp(scan, "scalar") == 0) {
+    return;
+  }
+
+#ifdef HAS_VECTOR_SCAN
+  __builtin_cpu_init();
+  bool isSse2Requested = scan != NULL && strcmp(scan, "sse2") == 0;
+  pClassifyFunction = (__builtin_cpu_supports("avx2") && !isSse2Requested) ? classifyAvx2 : classifySse2;
+#endif
+
+  return;
+}
+
+// Scans the first length characters of a name once, and returns its QUOTING_ flags
+int Quoting_classifyName(const char* name, int length) {
+  pthread_once(&classifyFunctionOnce, selectClassifyFunction);
+
+  return (*pClassifyFunction)(name, length);
+}
@@ -0,0 +1,16 @@
+// Handles the special characters that decide how file names are quoted
+#ifndef _QUOTING_H_
+#define _QUOTING_H_
+
+// The name contains one of " !$^&()`\"", and is printed in single quotes
+#define QUOTING_SPECIAL 1
+
+// The name contains a single quote, and is printed in double quotes
+#define QUOTING_SINGLE_QUOTE 2
+
+// Scans the first length characters of a name once, and returns its QUOTING_ flags
+// Uses AVX2 or SSE2 when the processor supports them, selected the first time it is called
+// Safe to call from multiple threads
+int Quoting_classifyName(const char* name, int length);
+
+#endif
@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "record.h"
+
+// The magic bytes at the start of binary output
+#define BINARY_MAGIC "LISTBIN1"
+
+// The types of binary records
+#define RECORD_ENTRY 1
+#define RECORD_DIRECTORY 2
+#define RECORD_ERROR 3
+
+// The start of every binary record, in host byte order
+// length is the # of bytes in the record after this header
+typedef struct {
+  uint32_t length;
+  uint32_t type;
+} BinaryRecordHeader;
+
+// The fixed fields of a binary entry record, followed by the name bytes and then the link target bytes
+// Every field is 64 bits wide so that the layout has no padding
+typedef struct {
+  uint64_t device;
+  uint64_t inode;
+  uint64_t mode;
+  uint64_t links;
+  uint64_t userId;
+  uint64_t groupId;
+  uint64_t specialDevice;
+  int64_t size;
+  int64_t blocks;
+  int64_t accessSeconds;
+  int64_t accessNanoseconds;
+  int64_t modifySeconds;
+  int64_t modifyNanoseconds;
+  int64_t changeSeconds;
+  int64_t changeNanoseconds;
+  uint64_t nameLength;
+  uint64_t targetLength;
+} BinaryEntry;
+
+// Gets the length of the UTF-8 sequence starting at string[index], or 0 if it is not a valid sequence
+// Overlong forms, surrogates and code points past U+10FFFF are not valid
+static int getUtf8SequenceLength(const unsigned char* string, size_t length, size_t index) {
+  unsigned char first = string[index];
+  int sequenceLength;
+  unsigned char minimum = 0x80;
+  unsigned char maximum = 0xbf;
+
+  if (first < 0x80) {
+    return 1;
+  } else if (first >= 0xc2 && first <= 0xdf) {
+    sequenceLength = 2;
+  } else if (first >= 0xe0 && first <= 0xef) {
+    sequenceLength = 3;
+    minimum = (first == 0xe0) ? 0xa0 : 0x80;
+    maximum = (first == 0xed) ? 0x9f : 0xbf;
+  } else if (first >= 0xf0 && first <= 0xf4) {
+    sequenceLength = 4;
+    minimum = (first == 0xf0) ? 0x90 : 0x80;
+    maximum = (first == 0xf4) ? 0x8f : 0xbf;
+  } else {
+    return 0;
+  }
+
+  if (length - index < (size_t) sequenceLength || string[index + 1] < minimum || string[index + 1] > maximum) {
+    return 0;
+  }
+
+  for (int i = 2; i < sequenceLength; i++) {
+    if (string[index + i] < 0x80 || string[index + i] > 0xbf) {
+      return 0;
+    }
+  }
+
+  return sequenceLength;
+}
+
+// Checks whether a string of length bytes is valid UTF-8
+static bool isValidUtf8(const char* string, size_t length) {
+  size_t i = 0;
+
+  while (i < length) {
+    int sequenceLength = getUtf8SequenceLength((const unsigned char*) string, length, i);
+
+    if (sequenceLength == 0) {
+      return false;
+    }
+    i += sequenceLength;
+  }
+
+  return true;
+}
+
+// Writes a string as the contents of a JSON string, escaping quotes, backslashes and control characters
+// Valid UTF-8 is written unchanged. Since file names are arbitrary bytes, a string that is not valid UTF-8
+// is written with every byte past ASCII escaped as \u0080 to \u00ff, so each character stands for one byte
+// Returns true if the string was written as bytes, so the caller can flag the member with a "_bytes" member
+static bool writeJsonString(Output* pOutput, const char* string, size_t length) {
+  static const char hexDigits[] = "0123456789abcdef";
+  bool isBytes = !isValidUtf8(string, length);
+  size_t start = 0;
+
+  Output_writeCharacter(pOutput, '"');
+
+  for (size_t i = 0; i < length; i++) {
+    unsigned char character = string[i];
+
+    if (character >= 0x20 && character != '"' && character != '\\' && (character < 0x80 || !isBytes)) {
+      continue;
+    }
+
+    // Write the run of characters that need no escaping in one piece
+    Output_write(pOutput, string + start, i - start);
+    start = i + 1;
+
+    if (character == '"' || character == '\\') {
+      Output_writeCharacter(pOutput, '\\');
+      Output_writeCharacter(pOutput, character);
+    } else if (character == '\n') {
+      Output_write(pOutput, "\\n", 2);
+    } else if (character == '\t') {
+      Output_write(pOutput, "\\t", 2);
+    } else {
+      char escape[] = {'\\', 'u', '0', '0', hexDigits[character >> 4], hexDigits[character & 0xf]};
+      Output_write(pOutput, escape, sizeof(escape));
+    }
+  }
+
+  Output_write(pOutput, string + start, length - start);
+  Output_writeCharacter(pOutput, '"');
+  return isBytes;
+}
+
+// Writes a JSON object member with a number value
+// key holds everything that comes before the value, including the separating comma
+static void writeJsonNumber(Output* pOutput, const char* key, long number) {
+  Output_writeString(pOutput, key);
+  Output_writeNumber(pOutput, number, 0);
+  return;
+}
+
+// Writes the header of a binary record
+static void writeBinaryHeader(Output* pOutput, uint32_t type, size_t length) {
+  BinaryRecordHeader header = {length, type};
+  Output_write(pOutput, (char*) &header, sizeof(BinaryRecordHeader));
+  return;
+}
+
+// Gets the name of a file type for JSON records
+static char* getTypeName(mode_t mode) {
+  switch (mode & S_IFMT) {
+    case S_IFREG: return "file";
+    case S_IFDIR: return "directory";
+    case S_IFLNK: return "link";
+    case S_IFIFO: return "fifo";
+    case S_IFSOCK: return "socket";
+    case S_IFCHR: return "character";
+    case S_IFBLK: return "block";
+  }
+
+  return "unknown";
+}
+
+// Writes anything that must come before the first record
+// Binary output starts with the magic bytes "LISTBIN1"
+void Record_writeHeader(Output* pOutput, OutputFormat format) {
+  if (format == FORMAT_BINARY) {
+    Output_write(pOutput, BINARY_MAGIC, strlen(BINARY_MAGIC));
+  }
+
+  return;
+}
+
+// Writes a record with the raw metadata and name bytes of a file
+// directoryFd is the directory that the entry name is relative to (or AT_FDCWD for paths)
+// It is used to read the target of symbolic links
+void Record_writeEntry(Output* pOutput, FileEntry* pEntry, int directoryFd, OutputFormat format) {
+  struct stat* pStatBuffer = &pEntry->statBuffer;
+  char target[PATH_MAX];
+  int targetLength = 0;
+
+  if (S_ISLNK(pStatBuffer->st_mode)) {
+    targetLength = readlinkat(directoryFd, pEntry->name, target, PATH_MAX);
+
+    if (targetLength == -1) {
+      targetLength = 0;
+    }
+  }
+
+  if (format == FORMAT_BINARY) {
+    BinaryEntry entry = {
+      pStatBuffer->st_dev, pStatBuffer->st_ino, pStatBuffer->st_mode, pStatBuffer->st_nlink,
+      pStatBuffer->st_uid, pStatBuffer->st_gid, pStatBuffer->st_rdev,
+      pStatBuffer->st_size, pStatBuffer->st_blocks,
+      pStatBuffer->st_atim.tv_sec, pStatBuffer->st_atim.tv_nsec,
+      pStatBuffer->st_mtim.tv_sec, pStatBuffer->st_mtim.tv_nsec,
+      pStatBuffer->st_ctim.tv_sec, pStatBuffer->st_ctim.tv_nsec,
+      pEntry->nameLength, targetLength
+    };
+
+    writeBinaryHeader(pOutput, RECORD_ENTRY, sizeof(BinaryEntry) + pEntry->nameLength + targetLength);
+    Output_write(pOutput, (char*) &entry, sizeof(BinaryEntry));
+    Output_write(pOutput, pEntry->name, pEntry->nameLength);
+    Output_write(pOutput, target, targetLength);
+    return;
+  }
+
+  Output_write(pOutput, "{\"name\":", 8);
+  if (writeJsonString(pOutput, pEntry->name, pEntry->nameLength)) {
+    Output_writeString(pOutput, ",\"name_bytes\":true");
+  }
+  Output_write(pOutput, ",\"type\":\"", 9);
+  Output_writeString(pOutput, getTypeName(pStatBuffer->st_mode));
+  Output_writeCharacter(pOutput, '"');
+  writeJsonNumber(pOutput, ",\"mode\":", pStatBuffer->st_mode & ~S_IFMT);
+  writeJsonNumber(pOutput, ",\"dev\":", pStatBuffer->st_dev);
+  writeJsonNumber(pOutput, ",\"ino\":", pStatBuffer->st_ino);
+  writeJsonNumber(pOutput, ",\"nlink\":", pStatBuffer->st_nlink);
+  writeJsonNumber(pOutput, ",\"uid\":", pStatBuffer->st_uid);
+  writeJsonNumber(pOutput, ",\"gid\":", pStatBuffer->st_gid);
+  writeJsonNumber(pOutput, ",\"rdev\":", pStatBuffer->st_rdev);
+  writeJsonNumber(pOutput, ",\"size\":", pStatBuffer->st_size);
+  writeJsonNumber(pOutput, ",\"blocks\":", pStatBuffer->st_blocks);
+  writeJsonNumber(pOutput, ",\"atime\":", pStatBuffer->st_atim.tv_sec);
+  writeJsonNumber(pOutput, ",\"atime_nsec\":", pStatBuffer->st_atim.tv_nsec);
+  writeJsonNumber(pOutput, ",\"mtime\":", pStatBuffer->st_mtim.tv_sec);
+  writeJsonNumber(pOutput, ",\"mtime_nsec\":", pStatBuffer->st_mtim.tv_nsec);
+  writeJsonNumber(pOutput, ",\"ctime\":", pStatBuffer->st_ctim.tv_sec);
+  writeJsonNumber(pOutput, ",\"ctime_nsec\":", pStatBuffer->st_ctim.tv_nsec);
+
+  if (S_ISLNK(pStatBuffer->st_mode)) {
+    Output_write(pOutput, ",\"target\":", 10);
+    if (writeJsonString(pOutput, target, targetLength)) {
+      Output_writeString(pOutput, ",\"target_bytes\":true");
+    }
+  }
+
+  Output_write(pOutput, "}\n", 2);
+  return;
+}
+
+// Writes a record for the path of a directory, which owns the entry records that follow it
+void Record_writeDirectory(Output* pOutput, char* directoryPath, OutputFormat format) {
+  size_t pathLength = strlen(directoryPath);
+
+  if (format == FORMAT_BINARY) {
+    writeBinaryHeader(pOutput, RECORD_DIRECTORY, pathLength);
+    Output_write(pOutput, directoryPath, pathLength);
+    return;
+  }
+
+  Output_write(pOutput, "{\"directory\":", 13);
+  if (writeJsonString(pOutput, directoryPath, pathLength)) {
+    Output_writeString(pOutput, ",\"directory_bytes\":true");
+  }
+  Output_write(pOutput, "}\n", 2);
+  return;
+}
+
+// Writes a record for an error message, made up of message, filename and reason
+// A trailing newline is left out of the record
+void Record_writeError(Output* pOutput, char* message, char* filename, char* reason, OutputFormat format) {
+  size_t messageLength = strlen(message);
+  size_t filenameLength = strlen(filename);
+  size_t reasonLength = strlen(reason);
+
+  if (reasonLength > 0 && reason[reasonLength - 1] == '\n') {
+    reasonLength--;
+  }
+
+  if (format == FORMAT_BINARY) {
+    writeBinaryHeader(pOutput, RECORD_ERROR, messageLength + filenameLength + reasonLength);
+    Output_write(pOutput, message, messageLength);
+    Output_write(pOutput, filename, filenameLength);
+    Output_write(pOutput, reason, reasonLength);
+    return;
+  }
+
+  // Build the whole message so that it is escaped as a single string
+  char* text = malloc(messageLength + filenameLength + reasonLength);
+  memcpy(text, message, messageLength);
+  memcpy(text + messageLength, filename, filenameLength);
+  memcpy(text + messageLength + filenameLength, reason, reasonLength);
+
+  Output_write(pOutput, "{\"error\":", 9);
+  if (writeJsonString(pOutput, text, messageLength + filenameLength + reasonLength)) {
+    Output_writeString(pOutput, ",\"error_bytes\":true");
+  }
+  Output_write(pOutput, "}\n", 2);
+
+  free(text);
+  text = NULL;
+  return;
+}
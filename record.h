@@ -0,0 +1,24 @@
+// Handles machine readable output records for the --format option
+#ifndef _RECORD_H_
+#define _RECORD_H_
+#include "options.h"
+#include "output.h"
+#include "entry.h"
+
+// Writes anything that must come before the first record
+// Binary output starts with the magic bytes "LISTBIN1"
+void Record_writeHeader(Output* pOutput, OutputFormat format);
+
+// Writes a record with the raw metadata and name bytes of a file
+// directoryFd is the directory that the entry name is relative to (or AT_FDCWD for paths)
+// It is used to read the target of symbolic links
+void Record_writeEntry(Output* pOutput, FileEntry* pEntry, int directoryFd, OutputFormat format);
+
+// Writes a record for the path of a directory, which owns the entry records that follow it
+void Record_writeDirectory(Output* pOutput, char* directoryPath, OutputFormat format);
+
+// Writes a record for an error message, made up of message, filename and reason
+// A trailing newline is left out of the record
+void Record_writeError(Output* pOutput, char* message, char* filename, char* reason, OutputFormat format);
+
+#endif
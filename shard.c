@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "shard.h"
+
+// The fewest entries a shard is given, so a thread is only started when it has enough files to stat
+#define SHARD_MIN_ENTRIES 4096
+
+// Information passed to each shard thread
+typedef struct {
+  SHARD_FUNCTION pFunction; // The function run for the shard
+  void* pArgument; // The argument passed to the function
+  int shardIndex; // The index of the shard
+} ShardThread;
+
+// Gets the # of shards to split entriesLength entries into, with at most jobsCount shards
+int Shard_getShardsLength(int entriesLength, int jobsCount) {
+  int shardsLength = entriesLength / SHARD_MIN_ENTRIES;
+
+  if (shardsLength > jobsCount) {
+    shardsLength = jobsCount;
+  }
+
+  return (shardsLength < 1) ? 1 : shardsLength;
+}
+
+// Gets the range of entries of a shard, from the index of its first entry up to but not including pEnd
+void Shard_getRange(int entriesLength, int shardsLength, int shardIndex, int* pStart, int* pEnd) {
+  *pStart = (long) entriesLength * shardIndex / shardsLength;
+  *pEnd = (long) entriesLength * (shardIndex + 1) / shardsLength;
+  return;
+}
+
+// Runs the function of a shard on its thread
+// Passed as an argument to pthread_create
+static void* runShardThread(void* pArgument) {
+  ShardThread* pThread = pArgument;
+  (*pThread->pFunction)(pThread->shardIndex, pThread->pArgument);
+  return NULL;
+}
+
+// Runs a function for every shard, each on its own thread, and waits for all of them to finish
+// A shard whose thread cannot be started is run by the calling thread instead
+void Shard_run(int shardsLength, SHARD_FUNCTION pFunction, void* pArgument) {
+  pthread_t* threads = malloc(sizeof(pthread_t) * shardsLength);
+  ShardThread* shardThreads = malloc(sizeof(ShardThread) * shardsLength);
+  int startedLength = 0;
+
+  for (int i = 1; i < shardsLength; i++) {
+    shardThreads[i].pFunction = pFunction;
+    shardThreads[i].pArgument = pArgument;
+    shardThreads[i].shardIndex = i;
+
+    if (pthread_create(&threads[i], NULL, runShardThread, &shardThreads[i]) != 0) {
+      break;
+    }
+    startedLength = i;
+  }
+
+  for (int i = startedLength + 1; i < shardsLength; i++) {
+    (*pFunction)(i, pArgument);
+  }
+
+  (*pFunction)(0, pArgument);
+
+  for (int i = 1; i <= startedLength; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  free(threads);
+  free(shardThreads);
+  return;
+}
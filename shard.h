@@ -0,0 +1,20 @@
+// Handles splitting the entries of a single large directory across threads (-j)
+#ifndef _SHARD_H_
+#define _SHARD_H_
+
+// Function called once for every shard, with the index of the shard and the argument passed to Shard_run
+typedef void (*SHARD_FUNCTION)(int shardIndex, void* pArgument);
+
+// Gets the # of shards to split entriesLength entries into, with at most jobsCount shards
+// Each shard gets enough entries to be worth a thread, so small directories get a single shard
+int Shard_getShardsLength(int entriesLength, int jobsCount);
+
+// Gets the range of entries of a shard, from the index of its first entry up to but not including pEnd
+// Shards are contiguous and in order, so the output of each can be written one after another
+void Shard_getRange(int entriesLength, int shardsLength, int shardIndex, int* pStart, int* pEnd);
+
+// Runs a function for every shard, each on its own thread, and waits for all of them to finish
+// The calling thread runs the first shard
+void Shard_run(int shardsLength, SHARD_FUNCTION pFunction, void* pArgument);
+
+#endif
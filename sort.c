@@ -1,16 +1,274 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <limits.h>
+#include "entry.h"
 #include "sort.h"
 
-// Lexicographical comparison function
-static int compare(const void* a, const void* b) {
-  return strncmp(*(char**) a, *(char**) b, PATH_MAX);
+// The # of bytes of each name cached in its sort key
+#define PREFIX_LENGTH 8
+
+// Partitions with at most this many keys are sorted by insertion sort
+#define INSERTION_SORT_LENGTH 16
+
+// A compact key sorted in place of an entry
+// The first bytes of the name are cached next to the entry index, so most comparisons never touch the name
+typedef struct {
+  uint64_t prefix; // The first 8 bytes of the name, most significant byte first, padded with zeros
+  int index; // The index of the entry in the entries array
+} SortKey;
+
+// Creates the sort key for an entry
+static SortKey createKey(FileEntry* entries, int index) {
+  SortKey key;
+  unsigned char* name = (unsigned char*) entries[index].name;
+  int prefixLength = (entries[index].nameLength < PREFIX_LENGTH) ? entries[index].nameLength : PREFIX_LENGTH;
+
+  key.prefix = 0;
+  for (int i = 0; i < PREFIX_LENGTH; i++) {
+    key.prefix = (key.prefix << 8) | ((i < prefixLength) ? name[i] : 0);
+  }
+  key.index = index;
+
+  return key;
+}
+
+// Gets the character of a key's name at depth, or 0 past the end of the name
+static int getCharacter(SortKey* pKey, FileEntry* entries, int depth) {
+  if (depth < PREFIX_LENGTH) {
+    return (pKey->prefix >> (8 * (PREFIX_LENGTH - 1 - depth))) & 0xff;
+  }
+
+  FileEntry* pEntry = &entries[pKey->index];
+  return (depth < pEntry->nameLength) ? (unsigned char) pEntry->name[depth] : 0;
+}
+
+// Lexicographical comparison function for two keys
+static int compareKeys(SortKey* pA, SortKey* pB, FileEntry* entries) {
+  if (pA->prefix != pB->prefix) {
+    return (pA->prefix < pB->prefix) ? -1 : 1;
+  }
+
+  // Names that end within the prefix are equal when their prefixes are
+  if (entries[pA->index].nameLength < PREFIX_LENGTH) {
+    return 0;
+  }
+
+  return strcmp(entries[pA->index].name + PREFIX_LENGTH, entries[pB->index].name + PREFIX_LENGTH);
+}
+
+// Sorts a small array of keys
+static void insertionSort(SortKey* keys, int length, FileEntry* entries) {
+  for (int i = 1; i < length; i++) {
+    SortKey key = keys[i];
+    int j = i - 1;
+
+    while (j >= 0 && compareKeys(&keys[j], &key, entries) > 0) {
+      keys[j + 1] = keys[j];
+      j--;
+    }
+
+    keys[j + 1] = key;
+  }
+
+  return;
+}
+
+static void swapKeys(SortKey* pA, SortKey* pB) {
+  SortKey temporary = *pA;
+  *pA = *pB;
+  *pB = temporary;
+  return;
+}
+
+// Sorts keys whose names are all equal before depth, with multikey quicksort
+// Each partitioning step splits the keys three ways on the character at depth,
+// so names are only ever compared one character at a time
+static void multikeySort(SortKey* keys, int length, int depth, FileEntry* entries) {
+  while (length > INSERTION_SORT_LENGTH) {
+    // Use the median of the first, middle and last characters as the pivot
+    int first = getCharacter(&keys[0], entries, depth);
+    int middle = getCharacter(&keys[length / 2], entries, depth);
+    int last = getCharacter(&keys[length - 1], entries, depth);
+    int pivot = (first < middle)
+      ? ((middle < last) ? middle : ((first < last) ? last : first))
+      : ((first < last) ? first : ((middle < last) ? last : middle));
+
+    // Partition into keys less than, equal to and greater than the pivot
+    int lessEnd = 0;
+    int greaterStart = length;
+    int i = 0;
+
+    while (i < greaterStart) {
+      int character = getCharacter(&keys[i], entries, depth);
+
+      if (character < pivot) {
+        swapKeys(&keys[lessEnd], &keys[i]);
+        lessEnd++;
+        i++;
+      } else if (character > pivot) {
+        greaterStart--;
+        swapKeys(&keys[i], &keys[greaterStart]);
+      } else {
+        i++;
+      }
+    }
+
+    multikeySort(keys, lessEnd, depth, entries);
+    multikeySort(keys + greaterStart, length - greaterStart, depth, entries);
+
+    // Names that are equal up to their end are fully sorted
+    if (pivot == 0) {
+      return;
+    }
+
+    // Continue with the keys equal to the pivot at the next character
+    keys += lessEnd;
+    length = greaterStart - lessEnd;
+    depth++;
+  }
+
+  insertionSort(keys, length, entries);
+  return;
+}
+
+// Moves entries into the order given by the sorted keys
+// Follows each cycle of the permutation, so every entry is moved once
+static void applyOrder(FileEntry* entries, SortKey* keys, int length) {
+  for (int i = 0; i < length; i++) {
+    if (keys[i].index == i || keys[i].index == -1) {
+      continue;
+    }
+
+    FileEntry temporary = entries[i];
+    int current = i;
+
+    while (keys[current].index != i) {
+      int next = keys[current].index;
+      entries[current] = entries[next];
+      keys[current].index = -1;
+      current = next;
+    }
+
+    entries[current] = temporary;
+    keys[current].index = -1;
+  }
+
+  return;
+}
+
+// Lexicographically sorts an array of file entries in place by name
+// Sorts compact keys holding cached name prefixes rather than the entries themselves
+void Sort_lexicographicalSort(int length, FileEntry* entries) {
+  if (length < 2) {
+    return;
+  }
+
+  SortKey* keys = malloc(sizeof(SortKey) * length);
+
+  for (int i = 0; i < length; i++) {
+    keys[i] = createKey(entries, i);
+  }
+
+  multikeySort(keys, length, 0, entries);
+  applyOrder(entries, keys, length);
+
+  free(keys);
+  return;
 }
 
-// Lexicographically sorts an array of strings in place
-void Sort_lexicographicalSort(int length, char** strings) {
-  qsort(strings, length, sizeof(char*), compare);
+// A key sorted in place of an entry when ordering by size or modification time
+// The index breaks ties, since it is the position of the entry in name order
+typedef struct {
+  int64_t value; // The size, or the modification time in seconds
+  int64_t fraction; // The nanoseconds of the modification time, or 0
+  int index; // The index of the entry in the entries array
+} ValueKey;
+
+// Gets the value that an entry is ordered by, along with its fraction
+static void getValue(FileEntry* pEntry, SortOrder order, int64_t* pValue, int64_t* pFraction) {
+  if (order == SORT_SIZE) {
+    *pValue = pEntry->statBuffer.st_size;
+    *pFraction = 0;
+  } else {
+    *pValue = pEntry->statBuffer.st_mtim.tv_sec;
+    *pFraction = pEntry->statBuffer.st_mtim.tv_nsec;
+  }
+
   return;
 }
+
+// Comparison function for value keys, putting larger values first and then lower indexes
+// Passed as an argument to qsort
+static int compareValueKeys(const void* pFirst, const void* pSecond) {
+  const ValueKey* pA = pFirst;
+  const ValueKey* pB = pSecond;
+
+  if (pA->value != pB->value) {
+    return (pA->value > pB->value) ? -1 : 1;
+  }
+
+  if (pA->fraction != pB->fraction) {
+    return (pA->fraction > pB->fraction) ? -1 : 1;
+  }
+
+  return (pA->index > pB->index) - (pA->index < pB->index);
+}
+
+// Reorders entries that are already sorted by name by size or modification time
+// Sorts compact keys holding the values rather than the entries themselves
+void Sort_orderEntries(int length, FileEntry* entries, SortOrder order) {
+  if (order == SORT_NAME || length < 2) {
+    return;
+  }
+
+  ValueKey* valueKeys = malloc(sizeof(ValueKey) * length);
+
+  for (int i = 0; i < length; i++) {
+    getValue(&entries[i], order, &valueKeys[i].value, &valueKeys[i].fraction);
+    valueKeys[i].index = i;
+  }
+
+  qsort(valueKeys, length, sizeof(ValueKey), compareValueKeys);
+
+  // The order is applied with the same cycle walk as name sorting
+  SortKey* keys = malloc(sizeof(SortKey) * length);
+
+  for (int i = 0; i < length; i++) {
+    keys[i].index = valueKeys[i].index;
+  }
+
+  applyOrder(entries, keys, length);
+
+  free(keys);
+  free(valueKeys);
+  return;
+}
+
+// Compares two entries by the value of the order alone, ignoring their names
+int Sort_compareValues(FileEntry* pA, FileEntry* pB, SortOrder order) {
+  if (order == SORT_NAME) {
+    return 0;
+  }
+
+  ValueKey keyA;
+  ValueKey keyB;
+  getValue(pA, order, &keyA.value, &keyA.fraction);
+  getValue(pB, order, &keyB.value, &keyB.fraction);
+  keyA.index = 0;
+  keyB.index = 0;
+
+  return compareValueKeys(&keyA, &keyB);
+}
+
+// Compares two entries by the value of the order, then by name
+int Sort_compareEntries(FileEntry* pA, FileEntry* pB, SortOrder order) {
+  int comparison = Sort_compareValues(pA, pB, order);
+
+  if (comparison != 0) {
+    return comparison;
+  }
+
+  return strcmp(pA->name, pB->name);
+}
@@ -1,9 +1,24 @@
 // Handles sorting
 #ifndef _SORT_H_
 #define _SORT_H_
+#include "entry.h"
+#include "options.h"
 
-// Lexicographically sorts an array of strings in place
+// Lexicographically sorts an array of file entries in place by name
 // Ignores any periods at the start of a string (to match ls behavior)
-void Sort_lexicographicalSort(int length, char** strings);
+void Sort_lexicographicalSort(int length, FileEntry* entries);
+
+// Reorders entries that are already sorted by name by size (largest first) or modification time (newest first)
+// Entries with equal values stay in name order. Does nothing for SORT_NAME
+// The statBuffer of every entry must hold its full metadata
+void Sort_orderEntries(int length, FileEntry* entries, SortOrder order);
+
+// Compares two entries by the value of the order alone, ignoring their names
+// Returns a negative number if pA sorts first, a positive number if pB sorts first, and 0 if the values are equal
+int Sort_compareValues(FileEntry* pA, FileEntry* pB, SortOrder order);
+
+// Compares two entries by the value of the order, then by name
+// Returns a negative number if pA sorts first, and a positive number if pB sorts first
+int Sort_compareEntries(FileEntry* pA, FileEntry* pB, SortOrder order);
 
 #endif
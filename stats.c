@@ -0,0 +1,183 @@
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "stats.h"
+#include "output.h"
+#include "helpers.h"
+
+// The # of nanoseconds in a millisecond
+#define NANOSECONDS_PER_MILLISECOND 1000000L
+
+// The width of the phase name column in the printed statistics
+#define PHASE_NAME_WIDTH 8
+
+// The width of the number columns in the printed statistics
+#define NUMBER_WIDTH 12
+
+// The names of the phases, in StatsPhase order
+static const char* phaseNames[STATS_PHASES_LENGTH] = {"read", "stat", "names", "sort", "format", "write"};
+
+// Statistics are only collected once enabled, so every counter is untouched by default
+static bool isEnabled = false;
+
+// The time the statistics were enabled
+static long enabledTime = 0;
+
+// The # of calls and total nanoseconds of each phase
+static long phaseCalls[STATS_PHASES_LENGTH];
+static long phaseNanoseconds[STATS_PHASES_LENGTH];
+
+// The traversal counters
+static long directoriesCount = 0;
+static long entriesCount = 0;
+static long bytesCount = 0;
+static int maxDepth = 0;
+
+// Reads the monotonic clock in nanoseconds
+static long getTime() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+// Writes a # of nanoseconds as milliseconds with 3 decimal places, right aligned in a field of width characters
+static void writeMilliseconds(Output* pOutput, long nanoseconds, int width) {
+  long microseconds = nanoseconds / 1000;
+  long fraction = microseconds % 1000;
+
+  Output_writeNumber(pOutput, microseconds / 1000, width - 4);
+  Output_writeCharacter(pOutput, '.');
+  Output_writeCharacter(pOutput, '0' + fraction / 100);
+  Output_writeCharacter(pOutput, '0' + fraction / 10 % 10);
+  Output_writeCharacter(pOutput, '0' + fraction % 10);
+  return;
+}
+
+// Writes a labelled count on its own line
+static void writeCount(Output* pOutput, const char* label, long count) {
+  Output_writeString(pOutput, label);
+  Output_writeNumber(pOutput, count, 0);
+  Output_writeCharacter(pOutput, '\n');
+  return;
+}
+
+// Starts collecting statistics, and the wall time of the whole listing
+// Until this is called, every other function returns right away
+void Stats_enable() {
+  isEnabled = true;
+  enabledTime = getTime();
+  return;
+}
+
+// Gets the current monotonic time in nanoseconds, to pass to Stats_stop at the end of a phase
+// Returns 0 without reading the clock if statistics are not enabled
+long Stats_start() {
+  if (!isEnabled) {
+    return 0;
+  }
+
+  return getTime();
+}
+
+// Adds the time since startTime and callsCount calls to a phase
+// Safe to call from multiple threads
+void Stats_stop(StatsPhase phase, long callsCount, long startTime) {
+  if (!isEnabled) {
+    return;
+  }
+
+  __atomic_fetch_add(&phaseCalls[phase], callsCount, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&phaseNanoseconds[phase], getTime() - startTime, __ATOMIC_RELAXED);
+  return;
+}
+
+// Counts a visited directory, at the given depth below its command line argument
+// Safe to call from multiple threads
+void Stats_addDirectory(int depth) {
+  if (!isEnabled) {
+    return;
+  }
+
+  __atomic_fetch_add(&directoriesCount, 1, __ATOMIC_RELAXED);
+
+  int previousMaxDepth = __atomic_load_n(&maxDepth, __ATOMIC_RELAXED);
+  while (depth > previousMaxDepth) {
+    if (__atomic_compare_exchange_n(&maxDepth, &previousMaxDepth, depth, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  return;
+}
+
+// Counts the entries visited in a directory
+// Safe to call from multiple threads
+void Stats_addEntries(long entriesLength) {
+  if (!isEnabled) {
+    return;
+  }
+
+  __atomic_fetch_add(&entriesCount, entriesLength, __ATOMIC_RELAXED);
+  return;
+}
+
+// Counts bytes written to standard output
+// Safe to call from multiple threads
+void Stats_addBytes(size_t bytesLength) {
+  if (!isEnabled) {
+    return;
+  }
+
+  __atomic_fetch_add(&bytesCount, bytesLength, __ATOMIC_RELAXED);
+  return;
+}
+
+// Prints the collected statistics to standard error
+// Does nothing if statistics are not enabled
+void Stats_print() {
+  if (!isEnabled) {
+    return;
+  }
+
+  long totalNanoseconds = getTime() - enabledTime;
+  long cacheHits;
+  long cacheMisses;
+  Helpers_getNameCacheCounts(&cacheHits, &cacheMisses);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // Stop counting before the statistics themselves are written
+  isEnabled = false;
+
+  Output output;
+  Output_initFile(&output, STDERR_FILENO);
+
+  Output_writePadded(&output, "phase", 5, PHASE_NAME_WIDTH);
+  Output_writePadded(&output, "       calls", NUMBER_WIDTH, NUMBER_WIDTH);
+  Output_writePadded(&output, "   time (ms)", NUMBER_WIDTH, NUMBER_WIDTH);
+  Output_writeCharacter(&output, '\n');
+
+  for (int i = 0; i < STATS_PHASES_LENGTH; i++) {
+    Output_writePadded(&output, phaseNames[i], strlen(phaseNames[i]), PHASE_NAME_WIDTH);
+    Output_writeNumber(&output, phaseCalls[i], NUMBER_WIDTH);
+    writeMilliseconds(&output, phaseNanoseconds[i], NUMBER_WIDTH);
+    Output_writeCharacter(&output, '\n');
+  }
+
+  Output_writePadded(&output, "total", 5, PHASE_NAME_WIDTH + NUMBER_WIDTH);
+  writeMilliseconds(&output, totalNanoseconds, NUMBER_WIDTH);
+  Output_writeCharacter(&output, '\n');
+
+  writeCount(&output, "directories: ", directoriesCount);
+  writeCount(&output, "entries: ", entriesCount);
+  writeCount(&output, "max depth: ", maxDepth);
+  writeCount(&output, "bytes written: ", bytesCount);
+  writeCount(&output, "name cache hits: ", cacheHits);
+  writeCount(&output, "name cache misses: ", cacheMisses);
+  writeCount(&output, "peak memory (KB): ", usage.ru_maxrss);
+
+  Output_free(&output);
+  return;
+}
@@ -0,0 +1,45 @@
+// Handles the traversal statistics printed by the --stats option
+#ifndef _STATS_H_
+#define _STATS_H_
+#include <stddef.h>
+
+// The timed phases of a listing
+typedef enum {
+  STATS_READ, // Reading directory entries
+  STATS_STAT, // Getting file metadata
+  STATS_NAMES, // Looking up user and group names that are not cached
+  STATS_SORT, // Sorting entries
+  STATS_FORMAT, // Formatting entries for printing
+  STATS_WRITE, // Writing output
+  STATS_PHASES_LENGTH
+} StatsPhase;
+
+// Starts collecting statistics, and the wall time of the whole listing
+// Until this is called, every other function returns right away
+void Stats_enable();
+
+// Gets the current monotonic time in nanoseconds, to pass to Stats_stop at the end of a phase
+// Returns 0 without reading the clock if statistics are not enabled
+long Stats_start();
+
+// Adds the time since startTime and callsCount calls to a phase
+// Safe to call from multiple threads
+void Stats_stop(StatsPhase phase, long callsCount, long startTime);
+
+// Counts a visited directory, at the given depth below its command line argument
+// Safe to call from multiple threads
+void Stats_addDirectory(int depth);
+
+// Counts the entries visited in a directory
+// Safe to call from multiple threads
+void Stats_addEntries(long entriesLength);
+
+// Counts bytes written to standard output
+// Safe to call from multiple threads
+void Stats_addBytes(size_t bytesLength);
+
+// Prints the collected statistics to standard error
+// Does nothing if statistics are not enabled
+void Stats_print();
+
+#endif
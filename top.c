@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include "top.h"
+#include "sort.h"
+
+// Initial # of entries a heap allocates memory for before growing
+#define INITIAL_HEAP_CAPACITY 64
+
+// Checks whether the entry at index a sorts after the entry at index b, so it belongs nearer the root
+static bool isWorse(TopHeap* pHeap, int a, int b) {
+  return Sort_compareEntries(&pHeap->entries[a], &pHeap->entries[b], pHeap->order) > 0;
+}
+
+static void swapEntries(FileEntry* pA, FileEntry* pB) {
+  FileEntry temporary = *pA;
+  *pA = *pB;
+  *pB = temporary;
+  return;
+}
+
+// Moves the entry at index up until its parent sorts after it
+static void siftUp(TopHeap* pHeap, int index) {
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+
+    if (!isWorse(pHeap, index, parent)) {
+      break;
+    }
+
+    swapEntries(&pHeap->entries[index], &pHeap->entries[parent]);
+    index = parent;
+  }
+
+  return;
+}
+
+// Moves the entry at index down until both of its children sort before it
+static void siftDown(TopHeap* pHeap, int index) {
+  while (true) {
+    int worst = index;
+    int left = 2 * index + 1;
+    int right = left + 1;
+
+    if (left < pHeap->length && isWorse(pHeap, left, worst)) {
+      worst = left;
+    }
+
+    if (right < pHeap->length && isWorse(pHeap, right, worst)) {
+      worst = right;
+    }
+
+    if (worst == index) {
+      break;
+    }
+
+    swapEntries(&pHeap->entries[index], &pHeap->entries[worst]);
+    index = worst;
+  }
+
+  return;
+}
+
+// Copies an entry, naming it by its path inside directoryPath if that is not NULL
+static void copyEntry(FileEntry* pCopy, FileEntry* pEntry, const char* directoryPath) {
+  *pCopy = *pEntry;
+
+  if (directoryPath == NULL) {
+    pCopy->name = malloc(pEntry->nameLength + 1);
+    memcpy(pCopy->name, pEntry->name, pEntry->nameLength + 1);
+    return;
+  }
+
+  int directoryLength = strlen(directoryPath);
+  bool needsSeparator = directoryLength > 0 && directoryPath[directoryLength - 1] != '/';
+
+  pCopy->nameLength = directoryLength + needsSeparator + pEntry->nameLength;
+  pCopy->name = malloc(pCopy->nameLength + 1);
+  memcpy(pCopy->name, directoryPath, directoryLength);
+  if (needsSeparator) {
+    pCopy->name[directoryLength] = '/';
+  }
+  memcpy(pCopy->name + directoryLength + needsSeparator, pEntry->name, pEntry->nameLength + 1);
+
+  return;
+}
+
+// Compares the path of a name inside directoryPath with another name, as strcmp would compare the joined path
+// Avoids building the path for entries that are rejected
+static int compareJoinedName(const char* directoryPath, const char* name, const char* otherName) {
+  const unsigned char* pCharacter = (const unsigned char*) directoryPath;
+  const unsigned char* pOther = (const unsigned char*) otherName;
+
+  for (; *pCharacter != '\0'; pCharacter++, pOther++) {
+    if (*pCharacter != *pOther) {
+      return *pCharacter - *pOther;
+    }
+  }
+
+  if (pCharacter != (const unsigned char*) directoryPath && pCharacter[-1] != '/') {
+    if (*pOther != '/') {
+      return '/' - *pOther;
+    }
+    pOther++;
+  }
+
+  return strcmp(name, (const char*) pOther);
+}
+
+// Initializes an empty heap that keeps the capacity best entries in the order
+// Memory for the entries is allocated as they are kept, so a large capacity costs nothing up front
+void Top_init(TopHeap* pHeap, int capacity, SortOrder order) {
+  pHeap->capacity = capacity;
+  pHeap->length = 0;
+  pHeap->allocatedLength = 0;
+  pHeap->order = order;
+  pHeap->entries = NULL;
+  return;
+}
+
+// Offers an entry to the heap, which keeps a copy of it if it is one of the best entries so far
+void Top_offer(TopHeap* pHeap, FileEntry* pEntry, const char* directoryPath) {
+  if (pHeap->length < pHeap->capacity) {
+    if (pHeap->length == pHeap->allocatedLength) {
+      pHeap->allocatedLength = (pHeap->allocatedLength == 0) ? INITIAL_HEAP_CAPACITY : pHeap->allocatedLength * 2;
+      if (pHeap->allocatedLength > pHeap->capacity) {
+        pHeap->allocatedLength = pHeap->capacity;
+      }
+      pHeap->entries = realloc(pHeap->entries, sizeof(FileEntry) * pHeap->allocatedLength);
+    }
+
+    copyEntry(&pHeap->entries[pHeap->length], pEntry, directoryPath);
+    pHeap->length++;
+    siftUp(pHeap, pHeap->length - 1);
+    return;
+  }
+
+  // The entry is only copied if it sorts before the worst kept entry
+  FileEntry* pRoot = &pHeap->entries[0];
+  int comparison = Sort_compareValues(pEntry, pRoot, pHeap->order);
+
+  if (comparison == 0) {
+    comparison = (directoryPath == NULL) ? strcmp(pEntry->name, pRoot->name) : compareJoinedName(directoryPath, pEntry->name, pRoot->name);
+  }
+
+  if (comparison >= 0) {
+    return;
+  }
+
+  free(pRoot->name);
+  copyEntry(pRoot, pEntry, directoryPath);
+  siftDown(pHeap, 0);
+  return;
+}
+
+// Sorts the kept entries best first, and sets the length and array pointer for them
+// Removes the worst entry from the root one at a time, filling the array from its end
+void Top_takeEntries(TopHeap* pHeap, int* pEntriesLength, FileEntry** pEntries) {
+  int entriesLength = pHeap->length;
+
+  while (pHeap->length > 1) {
+    pHeap->length--;
+    swapEntries(&pHeap->entries[0], &pHeap->entries[pHeap->length]);
+    siftDown(pHeap, 0);
+  }
+
+  *pEntriesLength = entriesLength;
+  *pEntries = pHeap->entries;
+
+  pHeap->length = 0;
+  pHeap->allocatedLength = 0;
+  pHeap->entries = NULL;
+  return;
+}
+
+// Frees entries taken from a heap, along with their names
+void Top_freeEntries(int entriesLength, FileEntry* entries) {
+  for (int i = 0; i < entriesLength; i++) {
+    free(entries[i].name);
+  }
+
+  free(entries);
+  return;
+}
+
+// Frees a heap and the entries it still holds
+void Top_free(TopHeap* pHeap) {
+  Top_freeEntries(pHeap->length, pHeap->entries);
+  pHeap->entries = NULL;
+  pHeap->length = 0;
+  pHeap->allocatedLength = 0;
+  return;
+}
@@ -0,0 +1,34 @@
+// Handles keeping the best entries of a listing in a bounded heap (--top)
+#ifndef _TOP_H_
+#define _TOP_H_
+#include "options.h"
+#include "entry.h"
+
+// A heap holding at most capacity entries, with the entry that sorts last at the root
+// Entries that sort after every kept entry are rejected without being copied
+typedef struct {
+  int capacity; // The most entries that are kept
+  int length; // The # of entries kept
+  int allocatedLength; // The # of entries the array can hold before it must grow, up to the capacity
+  SortOrder order; // The order that decides which entries are best
+  FileEntry* entries; // The kept entries, each with a name allocated separately
+} TopHeap;
+
+// Initializes an empty heap that keeps the capacity best entries in the order
+void Top_init(TopHeap* pHeap, int capacity, SortOrder order);
+
+// Offers an entry to the heap, which keeps a copy of it if it is one of the best entries so far
+// If directoryPath is not NULL, the copy is named by the entry's path inside that directory
+void Top_offer(TopHeap* pHeap, FileEntry* pEntry, const char* directoryPath);
+
+// Sorts the kept entries best first, and sets the length and array pointer for them
+// The heap is left empty, and the entries must eventually be freed with Top_freeEntries
+void Top_takeEntries(TopHeap* pHeap, int* pEntriesLength, FileEntry** pEntries);
+
+// Frees entries taken from a heap, along with their names
+void Top_freeEntries(int entriesLength, FileEntry* entries);
+
+// Frees a heap and the entries it still holds
+void Top_free(TopHeap* pHeap);
+
+#endif
@@ -0,0 +1,364 @@
+// syscall and the statx structure are only declared for GNU sources
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include "entry.h"
+#include "uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAS_IO_URING
+#endif
+#endif
+
+#ifdef HAS_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// The # of statx requests kept in flight at once
+#define RING_ENTRIES 128
+
+// An io_uring instance and its memory mapped queues
+typedef struct {
+  int ringFd; // The io_uring file descriptor
+  void* submissionMemory; // The mapped submission queue ring
+  size_t submissionMemoryLength; // The length of the mapped submission queue ring
+  void* completionMemory; // The mapped completion queue ring (may be the same mapping as the submission ring)
+  size_t completionMemoryLength; // The length of the mapped completion queue ring
+  struct io_uring_sqe* submissionEntries; // The mapped submission queue entries
+  unsigned* submissionHead; // Index of the next submission consumed by the kernel
+  unsigned* submissionTail; // Index of the next submission written by us
+  unsigned* submissionMask; // Mask for indexing the submission ring
+  unsigned* submissionArray; // Maps submission ring slots to submission entries
+  unsigned* completionHead; // Index of the next completion read by us
+  unsigned* completionTail; // Index of the next completion written by the kernel
+  unsigned* completionMask; // Mask for indexing the completion ring
+  struct io_uring_cqe* completionEntries; // The mapped completion queue entries
+  struct statx statxBuffers[RING_ENTRIES]; // The result buffer of each in-flight request
+} Ring;
+
+// Each thread's ring
+static pthread_key_t ringKey;
+static pthread_once_t ringKeyOnce = PTHREAD_ONCE_INIT;
+
+// Set once io_uring (or statx within io_uring) has been found to be unavailable
+// Read and written by every thread, so it is only accessed with atomics
+static bool isUnavailable = false;
+
+// Frees a ring and unmaps its queues
+static void destroyRing(void* pArgument) {
+  Ring* pRing = pArgument;
+
+  munmap(pRing->submissionEntries, RING_ENTRIES * sizeof(struct io_uring_sqe));
+  if (pRing->completionMemory != pRing->submissionMemory) {
+    munmap(pRing->completionMemory, pRing->completionMemoryLength);
+  }
+  munmap(pRing->submissionMemory, pRing->submissionMemoryLength);
+  close(pRing->ringFd);
+  free(pRing);
+
+  return;
+}
+
+static void createRingKey() {
+  pthread_key_create(&ringKey, destroyRing);
+  return;
+}
+
+// Sets up an io_uring instance and maps its queues
+// Returns NULL if io_uring is unavailable
+static Ring* createRing() {
+  struct io_uring_params parameters;
+  memset(&parameters, 0, sizeof(parameters));
+
+  int ringFd = syscall(__NR_io_uring_setup, RING_ENTRIES, &parameters);
+
+  if (ringFd == -1) {
+    return NULL;
+  }
+
+  Ring* pRing = malloc(sizeof(Ring));
+  pRing->ringFd = ringFd;
+  pRing->submissionMemoryLength = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+  pRing->completionMemoryLength = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+
+  // Newer kernels map both rings with a single mapping
+  if (parameters.features & IORING_FEAT_SINGLE_MMAP) {
+    if (pRing->completionMemoryLength > pRing->submissionMemoryLength) {
+      pRing->submissionMemoryLength = pRing->completionMemoryLength;
+    }
+    pRing->completionMemoryLength = pRing->submissionMemoryLength;
+  }
+
+  pRing->submissionMemory = mmap(NULL, pRing->submissionMemoryLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+
+  if (pRing->submissionMemory == MAP_FAILED) {
+    close(ringFd);
+    free(pRing);
+    return NULL;
+  }
+
+  if (parameters.features & IORING_FEAT_SINGLE_MMAP) {
+    pRing->completionMemory = pRing->submissionMemory;
+  } else {
+    pRing->completionMemory = mmap(NULL, pRing->completionMemoryLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+
+    if (pRing->completionMemory == MAP_FAILED) {
+      munmap(pRing->submissionMemory, pRing->submissionMemoryLength);
+      close(ringFd);
+      free(pRing);
+      return NULL;
+    }
+  }
+
+  pRing->submissionEntries = mmap(NULL, RING_ENTRIES * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+  if (pRing->submissionEntries == MAP_FAILED) {
+    if (pRing->completionMemory != pRing->submissionMemory) {
+      munmap(pRing->completionMemory, pRing->completionMemoryLength);
+    }
+    munmap(pRing->submissionMemory, pRing->submissionMemoryLength);
+    close(ringFd);
+    free(pRing);
+    return NULL;
+  }
+
+  char* submissionMemory = pRing->submissionMemory;
+  pRing->submissionHead = (unsigned*) (submissionMemory + parameters.sq_off.head);
+  pRing->submissionTail = (unsigned*) (submissionMemory + parameters.sq_off.tail);
+  pRing->submissionMask = (unsigned*) (submissionMemory + parameters.sq_off.ring_mask);
+  pRing->submissionArray = (unsigned*) (submissionMemory + parameters.sq_off.array);
+
+  char* completionMemory = pRing->completionMemory;
+  pRing->completionHead = (unsigned*) (completionMemory + parameters.cq_off.head);
+  pRing->completionTail = (unsigned*) (completionMemory + parameters.cq_off.tail);
+  pRing->completionMask = (unsigned*) (completionMemory + parameters.cq_off.ring_mask);
+  pRing->completionEntries = (struct io_uring_cqe*) (completionMemory + parameters.cq_off.cqes);
+
+  return pRing;
+}
+
+// Gets the ring of the calling thread, creating it if needed
+// Returns NULL if io_uring is unavailable
+static Ring* getRing() {
+  pthread_once(&ringKeyOnce, createRingKey);
+  Ring* pRing = pthread_getspecific(ringKey);
+
+  if (pRing == NULL) {
+    pRing = createRing();
+
+    if (pRing == NULL) {
+      __atomic_store_n(&isUnavailable, true, __ATOMIC_RELAXED);
+      return NULL;
+    }
+
+    pthread_setspecific(ringKey, pRing);
+  }
+
+  return pRing;
+}
+
+// Checks whether a statx buffer is in the list of free buffers
+static bool isSlotFree(int* freeSlots, int freeSlotsLength, int slot) {
+  for (int i = 0; i < freeSlotsLength; i++) {
+    if (freeSlots[i] == slot) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Converts a statx result into a stat structure
+static void convertStatx(struct statx* pStatx, struct stat* pStatBuffer) {
+  memset(pStatBuffer, 0, sizeof(struct stat));
+
+  pStatBuffer->st_dev = makedev(pStatx->stx_dev_major, pStatx->stx_dev_minor);
+  pStatBuffer->st_ino = pStatx->stx_ino;
+  pStatBuffer->st_mode = pStatx->stx_mode;
+  pStatBuffer->st_nlink = pStatx->stx_nlink;
+  pStatBuffer->st_uid = pStatx->stx_uid;
+  pStatBuffer->st_gid = pStatx->stx_gid;
+  pStatBuffer->st_rdev = makedev(pStatx->stx_rdev_major, pStatx->stx_rdev_minor);
+  pStatBuffer->st_size = pStatx->stx_size;
+  pStatBuffer->st_blksize = pStatx->stx_blksize;
+  pStatBuffer->st_blocks = pStatx->stx_blocks;
+  pStatBuffer->st_atim.tv_sec = pStatx->stx_atime.tv_sec;
+  pStatBuffer->st_atim.tv_nsec = pStatx->stx_atime.tv_nsec;
+  pStatBuffer->st_mtim.tv_sec = pStatx->stx_mtime.tv_sec;
+  pStatBuffer->st_mtim.tv_nsec = pStatx->stx_mtime.tv_nsec;
+  pStatBuffer->st_ctim.tv_sec = pStatx->stx_ctime.tv_sec;
+  pStatBuffer->st_ctim.tv_nsec = pStatx->stx_ctime.tv_nsec;
+
+  return;
+}
+
+// Collects every available completion, storing each result in its entry and freeing its buffer
+// A request that failed is retried with fstatat
+// Returns the # of completions collected
+static int collectCompletions(Ring* pRing, int directoryFd, FileEntry* entries, int* slotEntries, int* freeSlots, int* pFreeSlotsLength) {
+  unsigned head = *pRing->completionHead;
+  unsigned completionTail = __atomic_load_n(pRing->completionTail, __ATOMIC_ACQUIRE);
+  int collectedLength = 0;
+
+  while (head != completionTail) {
+    struct io_uring_cqe* pCompletion = &pRing->completionEntries[head & *pRing->completionMask];
+    int slot = pCompletion->user_data;
+    FileEntry* pEntry = &entries[slotEntries[slot]];
+
+    if (pCompletion->res == 0) {
+      convertStatx(&pRing->statxBuffers[slot], &pEntry->statBuffer);
+    } else {
+      // Kernels without statx support in io_uring reject the request as invalid
+      if (pCompletion->res == -EINVAL) {
+        __atomic_store_n(&isUnavailable, true, __ATOMIC_RELAXED);
+      }
+      fstatat(directoryFd, pEntry->name, &pEntry->statBuffer, AT_SYMLINK_NOFOLLOW);
+    }
+
+    freeSlots[(*pFreeSlotsLength)++] = slot;
+    collectedLength++;
+    head++;
+  }
+
+  __atomic_store_n(pRing->completionHead, head, __ATOMIC_RELEASE);
+  return collectedLength;
+}
+
+// Finishes statting a directory synchronously after io_uring_enter fails
+// Requests the kernel has not consumed are taken back out of the ring, and requests already in flight are
+// waited for, so that no statx buffer is written once the ring is used again
+// Every entry that has no result yet is statted with fstatat
+static void abandonRequests(Ring* pRing, int directoryFd, int entriesLength, FileEntry* entries, const int* order, int nextEntry, int* slotEntries, int* freeSlots, int* pFreeSlotsLength, int inFlightLength) {
+  __atomic_store_n(&isUnavailable, true, __ATOMIC_RELAXED);
+
+  unsigned head = __atomic_load_n(pRing->submissionHead, __ATOMIC_ACQUIRE);
+  unsigned tail = *pRing->submissionTail;
+
+  for (unsigned i = head; i != tail; i++) {
+    struct io_uring_sqe* pSubmission = &pRing->submissionEntries[pRing->submissionArray[i & *pRing->submissionMask]];
+    FileEntry* pEntry = &entries[slotEntries[pSubmission->user_data]];
+    fstatat(directoryFd, pEntry->name, &pEntry->statBuffer, AT_SYMLINK_NOFOLLOW);
+  }
+  __atomic_store_n(pRing->submissionTail, head, __ATOMIC_RELEASE);
+
+  for (int k = nextEntry; k < entriesLength; k++) {
+    int i = (order == NULL) ? k : order[k];
+    fstatat(directoryFd, entries[i].name, &entries[i].statBuffer, AT_SYMLINK_NOFOLLOW);
+  }
+
+  while (inFlightLength > 0) {
+    int status = syscall(__NR_io_uring_enter, pRing->ringFd, 0, inFlightLength, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    if (status == -1 && errno != EINTR) {
+      // The ring cannot be waited on, so it is never used or freed again, since the kernel may still write to it
+      pthread_setspecific(ringKey, NULL);
+      for (int i = 0; i < RING_ENTRIES; i++) {
+        if (!isSlotFree(freeSlots, *pFreeSlotsLength, i)) {
+          FileEntry* pEntry = &entries[slotEntries[i]];
+          fstatat(directoryFd, pEntry->name, &pEntry->statBuffer, AT_SYMLINK_NOFOLLOW);
+        }
+      }
+      return;
+    }
+
+    inFlightLength -= collectCompletions(pRing, directoryFd, entries, slotEntries, freeSlots, pFreeSlotsLength);
+  }
+
+  return;
+}
+
+// Stats every entry in a directory with batches of asynchronous statx requests
+// Requests are submitted in the order of the entry indexes in order, or in array order if it is NULL
+// Returns false without statting any entries if io_uring is unavailable
+bool Uring_statEntries(int directoryFd, int entriesLength, FileEntry* entries, const int* order) {
+  if (__atomic_load_n(&isUnavailable, __ATOMIC_RELAXED)) {
+    return false;
+  }
+
+  Ring* pRing = getRing();
+
+  if (pRing == NULL) {
+    return false;
+  }
+
+  // freeSlots holds the statx buffers that are not in use, slotEntries maps each buffer to its entry
+  int freeSlots[RING_ENTRIES];
+  int freeSlotsLength = RING_ENTRIES;
+  int slotEntries[RING_ENTRIES];
+
+  for (int i = 0; i < RING_ENTRIES; i++) {
+    freeSlots[i] = i;
+  }
+
+  int nextEntry = 0;
+  int completedLength = 0;
+  int inFlightLength = 0;
+
+  while (completedLength < entriesLength) {
+    // Queue a request for as many entries as there are free buffers
+    unsigned tail = *pRing->submissionTail;
+
+    while (nextEntry < entriesLength && freeSlotsLength > 0) {
+      int slot = freeSlots[--freeSlotsLength];
+      int entryIndex = (order == NULL) ? nextEntry : order[nextEntry];
+      slotEntries[slot] = entryIndex;
+
+      unsigned index = tail & *pRing->submissionMask;
+      struct io_uring_sqe* pSubmission = &pRing->submissionEntries[index];
+      memset(pSubmission, 0, sizeof(struct io_uring_sqe));
+      pSubmission->opcode = IORING_OP_STATX;
+      pSubmission->fd = directoryFd;
+      pSubmission->addr = (unsigned long) entries[entryIndex].name;
+      pSubmission->len = STATX_BASIC_STATS;
+      pSubmission->off = (unsigned long) &pRing->statxBuffers[slot];
+      pSubmission->statx_flags = AT_SYMLINK_NOFOLLOW;
+      pSubmission->user_data = slot;
+      pRing->submissionArray[index] = index;
+
+      tail++;
+      nextEntry++;
+    }
+
+    __atomic_store_n(pRing->submissionTail, tail, __ATOMIC_RELEASE);
+
+    // Submit every queued request the kernel has not consumed yet, and wait for at least one to complete
+    // The kernel moves the submission head past every request it consumed, even when it only consumes some
+    // of them or returns an error, so the rest are submitted again on the next pass
+    unsigned head = __atomic_load_n(pRing->submissionHead, __ATOMIC_ACQUIRE);
+    int status = syscall(__NR_io_uring_enter, pRing->ringFd, tail - head, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    int error = errno;
+    inFlightLength += __atomic_load_n(pRing->submissionHead, __ATOMIC_ACQUIRE) - head;
+
+    // A signal or a full completion queue only delays the requests, so they are collected and submitted again
+    if (status == -1 && error != EINTR && error != EBUSY) {
+      abandonRequests(pRing, directoryFd, entriesLength, entries, order, nextEntry, slotEntries, freeSlots, &freeSlotsLength, inFlightLength);
+      return true;
+    }
+
+    int collectedLength = collectCompletions(pRing, directoryFd, entries, slotEntries, freeSlots, &freeSlotsLength);
+    completedLength += collectedLength;
+    inFlightLength -= collectedLength;
+  }
+
+  return true;
+}
+
+#else
+
+// Stats every entry in a directory with batches of asynchronous statx requests
+// io_uring is unavailable on this platform
+bool Uring_statEntries(int directoryFd, int entriesLength, FileEntry* entries, const int* order) {
+  return false;
+}
+
+#endif
@@ -0,0 +1,14 @@
+// Handles batched asynchronous metadata fetching with io_uring
+#ifndef _URING_H_
+#define _URING_H_
+#include <stdbool.h>
+#include "entry.h"
+
+// Stats every entry in a directory with batches of asynchronous statx requests
+// Entry names are relative to directoryFd, and symbolic links are not followed
+// Each calling thread gets its own ring, which is created the first time it is needed
+// Requests are submitted in the order of the entry indexes in order, or in array order if it is NULL
+// Returns false without statting any entries if io_uring is unavailable
+bool Uring_statEntries(int directoryFd, int entriesLength, FileEntry* entries, const int* order);
+
+#endif
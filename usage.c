@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "usage.h"
+
+// Initial # of items a growable array or hash table can hold before growing
+#define INITIAL_USAGE_CAPACITY 64
+
+// Initializes the usage of a directory from its own metadata
+// pDirectoryStatBuffer is NULL if the directory could not be listed
+void Usage_init(Usage* pUsage, struct stat* pDirectoryStatBuffer) {
+  memset(pUsage, 0, sizeof(Usage));
+
+  if (pDirectoryStatBuffer != NULL) {
+    pUsage->isListed = true;
+    pUsage->directoryBlocks = pDirectoryStatBuffer->st_blocks;
+    pUsage->directorySize = pDirectoryStatBuffer->st_size;
+  }
+
+  return;
+}
+
+// Adds the metadata of listed entries to the usage of their directory
+// Files with more than one hard link are held back until Usage_countLinks
+void Usage_addEntries(Usage* pUsage, int entriesLength, FileEntry* entries) {
+  for (int i = 0; i < entriesLength; i++) {
+    struct stat* pStatBuffer = &entries[i].statBuffer;
+
+    if (pStatBuffer->st_nlink <= 1 || S_ISDIR(pStatBuffer->st_mode)) {
+      pUsage->blocks += pStatBuffer->st_blocks;
+      pUsage->size += pStatBuffer->st_size;
+      continue;
+    }
+
+    if (pUsage->linksLength == pUsage->linksCapacity) {
+      pUsage->linksCapacity = (pUsage->linksCapacity == 0) ? INITIAL_USAGE_CAPACITY : pUsage->linksCapacity * 2;
+      pUsage->links = realloc(pUsage->links, sizeof(UsageLink) * pUsage->linksCapacity);
+    }
+
+    UsageLink* pLink = &pUsage->links[pUsage->linksLength];
+    pUsage->linksLength++;
+
+    pLink->device = pStatBuffer->st_dev;
+    pLink->inode = pStatBuffer->st_ino;
+    pLink->blocks = pStatBuffer->st_blocks;
+    pLink->size = pStatBuffer->st_size;
+  }
+
+  return;
+}
+
+// Finds the slot of a file in a hash table of hard linked files
+// Returns the slot holding the file, or the empty slot where it would be added
+static UsageLink* findLinkSlot(UsageLink* links, int capacity, dev_t device, ino_t inode) {
+  uint64_t hash = ((uint64_t) inode * 0x9e3779b97f4a7c15) ^ (uint64_t) device;
+  int index = (hash ^ (hash >> 29)) & (capacity - 1);
+
+  // The capacity is a power of 2, so the index wraps with a mask
+  while (links[index].inode != 0 && (links[index].inode != inode || links[index].device != device)) {
+    index = (index + 1) & (capacity - 1);
+  }
+
+  return &links[index];
+}
+
+// Doubles the capacity of the hash table of hard linked files and moves all files into the new slots
+static void growLinks(UsageReport* pReport) {
+  int capacity = (pReport->linksCapacity == 0) ? INITIAL_USAGE_CAPACITY : pReport->linksCapacity * 2;
+  UsageLink* links = calloc(capacity, sizeof(UsageLink));
+
+  for (int i = 0; i < pReport->linksCapacity; i++) {
+    if (pReport->links[i].inode != 0) {
+      *findLinkSlot(links, capacity, pReport->links[i].device, pReport->links[i].inode) = pReport->links[i];
+    }
+  }
+
+  free(pReport->links);
+  pReport->links = links;
+  pReport->linksCapacity = capacity;
+  return;
+}
+
+// Adds the hard linked files held back by a directory that have not been counted anywhere else yet
+// Directories must be passed in depth-first order, so every file is counted where a single thread finds it first
+void Usage_countLinks(Usage* pUsage, UsageReport* pReport) {
+  for (int i = 0; i < pUsage->linksLength; i++) {
+    UsageLink* pLink = &pUsage->links[i];
+
+    // Keep the hash table at most half full
+    if (2 * (pReport->linksLength + 1) > pReport->linksCapacity) {
+      growLinks(pReport);
+    }
+
+    UsageLink* pSlot = findLinkSlot(pReport->links, pReport->linksCapacity, pLink->device, pLink->inode);
+
+    if (pSlot->inode != 0) {
+      continue;
+    }
+
+    *pSlot = *pLink;
+    pReport->linksLength++;
+    pUsage->blocks += pLink->blocks;
+    pUsage->size += pLink->size;
+  }
+
+  free(pUsage->links);
+  pUsage->links = NULL;
+  pUsage->linksLength = 0;
+  pUsage->linksCapacity = 0;
+  return;
+}
+
+// Adds the usage below a subdirectory to the usage of its parent
+// The subdirectory itself is already counted as one of the parent's entries
+void Usage_merge(Usage* pUsage, Usage* pChildUsage) {
+  pUsage->blocks += pChildUsage->blocks;
+  pUsage->size += pChildUsage->size;
+  return;
+}
+
+// Frees a usage
+void Usage_free(Usage* pUsage) {
+  free(pUsage->links);
+  pUsage->links = NULL;
+  pUsage->linksLength = 0;
+  pUsage->linksCapacity = 0;
+  return;
+}
+
+// Initializes an empty report of the directories at most maxDepth below their command line directory
+void Usage_initReport(UsageReport* pReport, int maxDepth) {
+  memset(pReport, 0, sizeof(UsageReport));
+  pReport->maxDepth = maxDepth;
+  return;
+}
+
+// Reports the total of a listed directory once all of its subdirectories have been merged into its usage
+// depth is the # of directories between it and its command line directory
+void Usage_addLine(UsageReport* pReport, const char* path, size_t pathLength, int depth, Usage* pUsage) {
+  if (!pUsage->isListed || (pReport->maxDepth >= 0 && depth > pReport->maxDepth)) {
+    return;
+  }
+
+  if (pReport->linesLength == pReport->linesCapacity) {
+    pReport->linesCapacity = (pReport->linesCapacity == 0) ? INITIAL_USAGE_CAPACITY : pReport->linesCapacity * 2;
+    pReport->lines = realloc(pReport->lines, sizeof(UsageLine) * pReport->linesCapacity);
+  }
+
+  UsageLine* pLine = &pReport->lines[pReport->linesLength];
+  pReport->linesLength++;
+
+  pLine->path = malloc(pathLength + 1);
+  memcpy(pLine->path, path, pathLength);
+  pLine->path[pathLength] = '\0';
+  pLine->blocks = pUsage->directoryBlocks + pUsage->blocks;
+  pLine->size = pUsage->directorySize + pUsage->size;
+  return;
+}
+
+// Gets the # of digits needed to print a non-negative number
+static int countDigits(long long number) {
+  int digits = 1;
+
+  while (number >= 10) {
+    number /= 10;
+    digits++;
+  }
+
+  return digits;
+}
+
+// Prints the reported directory totals, and empties the report for the next command line directory
+// Each line has the disk usage in kibibytes, the apparent size in bytes, and the directory path
+void Usage_printReport(UsageReport* pReport, Output* out) {
+  int maxKibibytesDigits = 1;
+  int maxSizeDigits = 1;
+
+  for (int i = 0; i < pReport->linesLength; i++) {
+    int kibibytesDigits = countDigits((pReport->lines[i].blocks + 1) / 2);
+    int sizeDigits = countDigits(pReport->lines[i].size);
+
+    if (kibibytesDigits > maxKibibytesDigits) {
+      maxKibibytesDigits = kibibytesDigits;
+    }
+    if (sizeDigits > maxSizeDigits) {
+      maxSizeDigits = sizeDigits;
+    }
+  }
+
+  Output_writeString(out, "\ndisk usage:\n");
+
+  for (int i = 0; i < pReport->linesLength; i++) {
+    UsageLine* pLine = &pReport->lines[i];
+
+    Output_writeNumber(out, (pLine->blocks + 1) / 2, maxKibibytesDigits);
+    Output_writeCharacter(out, ' ');
+    Output_writeNumber(out, pLine->size, maxSizeDigits);
+    Output_writeCharacter(out, ' ');
+    Output_writeString(out, pLine->path);
+    Output_writeCharacter(out, '\n');
+    free(pLine->path);
+  }
+
+  pReport->linesLength = 0;
+  return;
+}
+
+// Frees a report
+void Usage_freeReport(UsageReport* pReport) {
+  for (int i = 0; i < pReport->linesLength; i++) {
+    free(pReport->lines[i].path);
+  }
+
+  free(pReport->lines);
+  free(pReport->links);
+  memset(pReport, 0, sizeof(UsageReport));
+  return;
+}
@@ -0,0 +1,81 @@
+// Handles summing the disk usage of directories and their subdirectories (--du)
+#ifndef _USAGE_H_
+#define _USAGE_H_
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "entry.h"
+#include "output.h"
+
+// A file with more than one hard link, which is only counted the first time it is found
+typedef struct {
+  dev_t device; // The device holding the file
+  ino_t inode; // The inode # of the file
+  long long blocks; // The # of 512 byte blocks allocated for the file
+  long long size; // The apparent size of the file in bytes
+} UsageLink;
+
+// The disk usage of a directory and everything below it, summed bottom-up as its subdirectories finish
+typedef struct {
+  bool isListed; // The directory could be listed, so it is reported
+  long long directoryBlocks; // The # of 512 byte blocks allocated for the directory itself
+  long long directorySize; // The apparent size of the directory itself in bytes
+  long long blocks; // The # of 512 byte blocks allocated for its entries and their contents
+  long long size; // The apparent size of its entries and their contents in bytes
+  int linksLength; // The # of hard linked files not yet checked against the files already counted
+  int linksCapacity; // The # of hard linked files the array can hold before it must grow
+  UsageLink* links; // The hard linked files not yet checked against the files already counted
+} Usage;
+
+// The total disk usage of a directory, reported once its subdirectories have all been summed
+typedef struct {
+  char* path; // The directory path, allocated separately
+  long long blocks; // The # of 512 byte blocks allocated for the directory and everything below it
+  long long size; // The apparent size of the directory and everything below it in bytes
+} UsageLine;
+
+// The hard linked files counted so far, and the directory totals reported for a command line directory
+typedef struct {
+  int maxDepth; // The deepest directory reported, relative to its command line directory, or -1 for every directory
+  int linksLength; // The # of hard linked files counted
+  int linksCapacity; // The # of slots in the hash table of hard linked files
+  UsageLink* links; // Hash table of hard linked files, where unused slots have an inode # of 0
+  int linesLength; // The # of directory totals
+  int linesCapacity; // The # of directory totals the array can hold before it must grow
+  UsageLine* lines; // The directory totals, each directory after all of its subdirectories
+} UsageReport;
+
+// Initializes the usage of a directory from its own metadata
+// pDirectoryStatBuffer is NULL if the directory could not be listed
+void Usage_init(Usage* pUsage, struct stat* pDirectoryStatBuffer);
+
+// Adds the metadata of listed entries to the usage of their directory
+// Files with more than one hard link are held back until Usage_countLinks
+void Usage_addEntries(Usage* pUsage, int entriesLength, FileEntry* entries);
+
+// Adds the hard linked files held back by a directory that have not been counted anywhere else yet
+// Directories must be passed in depth-first order, so every file is counted where a single thread finds it first
+void Usage_countLinks(Usage* pUsage, UsageReport* pReport);
+
+// Adds the usage below a subdirectory to the usage of its parent
+// The subdirectory itself is already counted as one of the parent's entries
+void Usage_merge(Usage* pUsage, Usage* pChildUsage);
+
+// Frees a usage
+void Usage_free(Usage* pUsage);
+
+// Initializes an empty report of the directories at most maxDepth below their command line directory
+void Usage_initReport(UsageReport* pReport, int maxDepth);
+
+// Reports the total of a listed directory once all of its subdirectories have been merged into its usage
+// depth is the # of directories between it and its command line directory
+void Usage_addLine(UsageReport* pReport, const char* path, size_t pathLength, int depth, Usage* pUsage);
+
+// Prints the reported directory totals, and empties the report for the next command line directory
+// Hard linked files stay counted, so a file found again under a later command line directory is not counted twice
+void Usage_printReport(UsageReport* pReport, Output* out);
+
+// Frees a report
+void Usage_freeReport(UsageReport* pReport);
+
+#endif
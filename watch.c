@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#include "watch.h"
+#include "entry.h"
+#include "sort.h"
+#include "directory.h"
+#include "arena.h"
+#include "details.h"
+
+#ifdef __linux__
+// Initial # of entries a watched directory can hold before growing
+#define INITIAL_WATCH_CAPACITY 64
+
+// The size of the buffer that inotify events are read into
+#define WATCH_BUFFER_LENGTH 65536
+
+// How long to wait for more events before redrawing a watched directory, in milliseconds
+#define WATCH_BATCH_MILLISECONDS 50
+
+// The most times events are read before a watched directory is redrawn, even if more keep arriving
+#define WATCH_MAX_BATCH_READS 20
+
+// A formatted line of a watched directory listing
+typedef struct {
+  char* data; // The formatted line, or NULL if the entry has changed since it was formatted
+  size_t length; // The # of bytes in the line
+} WatchLine;
+
+// The contents of a directory listed by the --watch option, kept sorted in memory
+// Each entry name is allocated separately, so entries can be inserted and removed as events arrive
+typedef struct {
+  char* path; // The path of the directory
+  DIR* directoryStream; // The open directory, which entries are statted relative to
+  int entriesLength; // The # of entries in the directory
+  int entriesCapacity; // The # of entries the arrays can hold before they must grow
+  FileEntry* entries; // The entries, sorted by name
+  WatchLine* lines; // The formatted line of each entry
+  FileGroupInfo groupInfo; // The column widths the lines were formatted with
+  Output lineOutput; // Memory buffer that each line is formatted into before being copied
+  bool hasRendered; // The directory has been printed at least once
+} WatchedDirectory;
+
+// Checks whether two groups of files are printed with the same column widths
+static bool isSameGroupInfo(FileGroupInfo* pInfo, FileGroupInfo* pOtherInfo) {
+  return pInfo->maxIdDigits == pOtherInfo->maxIdDigits
+    && pInfo->maxLinksDigits == pOtherInfo->maxLinksDigits
+    && pInfo->maxSizeDigits == pOtherInfo->maxSizeDigits
+    && pInfo->maxUserLetters == pOtherInfo->maxUserLetters
+    && pInfo->maxGroupLetters == pOtherInfo->maxGroupLetters
+    && pInfo->hasSpecialCharacters == pOtherInfo->hasSpecialCharacters;
+}
+
+// Finds the position of a name in a watched directory with a binary search
+// Sets pIsFound if an entry has the name, and returns either its index or the index it would be inserted at
+static int findWatchedEntry(WatchedDirectory* pDirectory, char* name, bool* pIsFound) {
+  int low = 0;
+  int high = pDirectory->entriesLength;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    int comparison = strcmp(pDirectory->entries[middle].name, name);
+
+    if (comparison == 0) {
+      *pIsFound = true;
+      return middle;
+    }
+
+    if (comparison < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  *pIsFound = false;
+  return low;
+}
+
+// Inserts an entry with a copy of name at index, shifting the following entries up
+// The entry has no metadata or formatted line until it is set by the caller
+static FileEntry* insertWatchedEntry(WatchedDirectory* pDirectory, int index, char* name, int nameLength) {
+  if (pDirectory->entriesLength == pDirectory->entriesCapacity) {
+    pDirectory->entriesCapacity = (pDirectory->entriesCapacity == 0) ? INITIAL_WATCH_CAPACITY : pDirectory->entriesCapacity * 2;
+    pDirectory->entries = realloc(pDirectory->entries, sizeof(FileEntry) * pDirectory->entriesCapacity);
+    pDirectory->lines = realloc(pDirectory->lines, sizeof(WatchLine) * pDirectory->entriesCapacity);
+  }
+
+  int movedLength = pDirectory->entriesLength - index;
+  memmove(&pDirectory->entries[index + 1], &pDirectory->entries[index], sizeof(FileEntry) * movedLength);
+  memmove(&pDirectory->lines[index + 1], &pDirectory->lines[index], sizeof(WatchLine) * movedLength);
+  pDirectory->entriesLength++;
+
+  FileEntry* pEntry = &pDirectory->entries[index];
+  pEntry->name = malloc(nameLength + 1);
+  memcpy(pEntry->name, name, nameLength + 1);
+  pEntry->nameLength = nameLength;
+  pEntry->type = 0;
+  pEntry->inode = 0;
+  memset(&pEntry->statBuffer, 0, sizeof(struct stat));
+
+  pDirectory->lines[index].data = NULL;
+  pDirectory->lines[index].length = 0;
+  return pEntry;
+}
+
+// Removes the entry at index, shifting the following entries down
+static void removeWatchedEntry(WatchedDirectory* pDirectory, int index) {
+  free(pDirectory->entries[index].name);
+  free(pDirectory->lines[index].data);
+
+  int movedLength = pDirectory->entriesLength - index - 1;
+  memmove(&pDirectory->entries[index], &pDirectory->entries[index + 1], sizeof(FileEntry) * movedLength);
+  memmove(&pDirectory->lines[index], &pDirectory->lines[index + 1], sizeof(WatchLine) * movedLength);
+  pDirectory->entriesLength--;
+
+  return;
+}
+
+// Removes every entry of a watched directory
+static void clearWatchedEntries(WatchedDirectory* pDirectory) {
+  for (int i = 0; i < pDirectory->entriesLength; i++) {
+    free(pDirectory->entries[i].name);
+    free(pDirectory->lines[i].data);
+  }
+  pDirectory->entriesLength = 0;
+
+  return;
+}
+
+// Reads, sorts and stats every entry of a watched directory, replacing any entries it already has
+// Used for the first listing, and again whenever events have been lost
+static void loadWatchedDirectory(WatchedDirectory* pDirectory, Options* pOptions) {
+  clearWatchedEntries(pDirectory);
+  rewinddir(pDirectory->directoryStream);
+
+  Arena arena;
+  Arena_init(&arena);
+  FileEntry* entries;
+  int entriesLength = Directory_readEntries(pDirectory->directoryStream, &arena, NULL, &entries);
+  Sort_lexicographicalSort(entriesLength, entries);
+  Directory_statEntries(dirfd(pDirectory->directoryStream), entriesLength, entries, Details_isTypeOnly(pOptions), pOptions->uringOption, pOptions->inodeOrderOption);
+
+  // The entries are already sorted, so each one is appended
+  for (int i = 0; i < entriesLength; i++) {
+    FileEntry* pEntry = insertWatchedEntry(pDirectory, i, entries[i].name, entries[i].nameLength);
+    pEntry->type = entries[i].type;
+    pEntry->inode = entries[i].inode;
+    pEntry->statBuffer = entries[i].statBuffer;
+  }
+
+  free(entries);
+  entries = NULL;
+  Arena_free(&arena);
+  return;
+}
+
+// Stats the entry at index again and marks its line to be formatted again
+// Returns false if the file no longer exists
+static bool restatWatchedEntry(WatchedDirectory* pDirectory, int index) {
+  FileEntry* pEntry = &pDirectory->entries[index];
+
+  if (fstatat(dirfd(pDirectory->directoryStream), pEntry->name, &pEntry->statBuffer, AT_SYMLINK_NOFOLLOW) == -1) {
+    return false;
+  }
+
+  pEntry->type = pEntry->statBuffer.st_mode & S_IFMT;
+  free(pDirectory->lines[index].data);
+  pDirectory->lines[index].data = NULL;
+  return true;
+}
+
+// Stats the other hard links to an inode in a watched directory again, since their link counts have changed
+// Adding or removing a link does not send an event for the names that already link to the inode
+static void restatHardLinks(WatchedDirectory* pDirectory, ino_t inode, dev_t device) {
+  for (int i = 0; i < pDirectory->entriesLength; i++) {
+    struct stat* pStatBuffer = &pDirectory->entries[i].statBuffer;
+
+    if (pStatBuffer->st_ino == inode && pStatBuffer->st_dev == device) {
+      restatWatchedEntry(pDirectory, i);
+    }
+  }
+
+  return;
+}
+
+// Applies a single inotify event for a name in a watched directory
+// With the -l or -i options, only the changed file is statted again, and it is removed if it no longer exists
+// Otherwise only names are printed, so the event itself says whether the name was added or removed
+static void updateWatchedEntry(WatchedDirectory* pDirectory, char* name, uint32_t mask, Options* pOptions) {
+  bool isFound;
+  int index = findWatchedEntry(pDirectory, name, &isFound);
+
+  if (pOptions->longOption || pOptions->indexOption) {
+    if (!isFound) {
+      insertWatchedEntry(pDirectory, index, name, strlen(name));
+    }
+
+    struct stat previousStatBuffer = pDirectory->entries[index].statBuffer;
+    bool isExisting = restatWatchedEntry(pDirectory, index);
+    struct stat* pStatBuffer = isExisting ? &pDirectory->entries[index].statBuffer : &previousStatBuffer;
+
+    if (!isExisting) {
+      removeWatchedEntry(pDirectory, index);
+    }
+
+    // Only files can have several hard links, and link counts are only printed with -l
+    if (pOptions->longOption && !S_ISDIR(pStatBuffer->st_mode) && (isFound != isExisting) && pStatBuffer->st_nlink > 1) {
+      restatHardLinks(pDirectory, pStatBuffer->st_ino, pStatBuffer->st_dev);
+    }
+
+    return;
+  }
+
+  if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+    if (isFound) {
+      removeWatchedEntry(pDirectory, index);
+    }
+  } else if (mask & (IN_CREATE | IN_MOVED_TO)) {
+    if (!isFound) {
+      FileEntry* pEntry = insertWatchedEntry(pDirectory, index, name, strlen(name));
+      pEntry->type = (mask & IN_ISDIR) ? S_IFDIR : 0;
+      pEntry->statBuffer.st_mode = pEntry->type;
+    }
+  }
+
+  return;
+}
+
+// Applies a buffer of inotify events to a watched directory
+// Repeated events for the same name (such as a burst of writes) only update the entry once
+// Sets pNeedsReload if events were lost, and pIsRemoved if the directory itself is gone
+static void applyWatchEvents(WatchedDirectory* pDirectory, char* buffer, ssize_t length, Options* pOptions, bool* pNeedsReload, bool* pIsRemoved) {
+  char* previousName = NULL;
+  ssize_t offset = 0;
+
+  while (offset < length) {
+    struct inotify_event* pEvent = (struct inotify_event*) (buffer + offset);
+    offset += sizeof(struct inotify_event) + pEvent->len;
+
+    if (pEvent->mask & IN_Q_OVERFLOW) {
+      *pNeedsReload = true;
+      continue;
+    }
+
+    if (pEvent->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT)) {
+      *pIsRemoved = true;
+      continue;
+    }
+
+    // Hidden files are never listed
+    if (pEvent->len == 0 || pEvent->name[0] == '.') {
+      continue;
+    }
+
+    // Entry creation and removal must be applied in order, but attribute changes can be merged
+    bool isAttributeChange = (pEvent->mask & (IN_ATTRIB | IN_MODIFY)) != 0;
+    if (isAttributeChange && previousName != NULL && strcmp(previousName, pEvent->name) == 0) {
+      continue;
+    }
+
+    updateWatchedEntry(pDirectory, pEvent->name, pEvent->mask, pOptions);
+    previousName = pEvent->name;
+  }
+
+  return;
+}
+
+// Prints the whole listing of a watched directory from memory
+// Only entries that changed since the last render are formatted again, unless the column widths changed
+// On a terminal the screen is cleared first, otherwise each listing is separated by an empty line
+static void renderWatchedDirectory(Output* out, WatchedDirectory* pDirectory, bool isTerminal, Options* pOptions) {
+  FileGroupInfo groupInfo;
+  Details_getGroupInfo(pDirectory->entriesLength, pDirectory->entries, pOptions, &groupInfo);
+  bool isSameWidth = isSameGroupInfo(&groupInfo, &pDirectory->groupInfo);
+  pDirectory->groupInfo = groupInfo;
+
+  int directoryFd = dirfd(pDirectory->directoryStream);
+  Output* pLineOutput = &pDirectory->lineOutput;
+
+  for (int i = 0; i < pDirectory->entriesLength; i++) {
+    WatchLine* pLine = &pDirectory->lines[i];
+
+    if (pLine->data != NULL && isSameWidth) {
+      continue;
+    }
+
+    pLineOutput->length = 0;
+    Details_printEntry(pLineOutput, &pDirectory->entries[i], directoryFd, &groupInfo, pOptions);
+
+    pLine->data = realloc(pLine->data, pLineOutput->length);
+    memcpy(pLine->data, pLineOutput->data, pLineOutput->length);
+    pLine->length = pLineOutput->length;
+  }
+
+  if (isTerminal) {
+    Output_writeString(out, "\033[H\033[2J");
+  } else if (pDirectory->hasRendered) {
+    Output_writeCharacter(out, '\n');
+  }
+
+  for (int i = 0; i < pDirectory->entriesLength; i++) {
+    Output_write(out, pDirectory->lines[i].data, pDirectory->lines[i].length);
+  }
+
+  Output_flush(out);
+  pDirectory->hasRendered = true;
+  return;
+}
+
+// Lists a directory, then keeps the listing up to date until the directory is removed (--watch)
+// Changes are received from inotify, so only the files named by events are accessed again
+// Events that arrive close together are applied as a batch before the listing is printed again
+void Watch_run(Output* out, char* directoryPath, Options* pOptions) {
+  int inotifyFd = inotify_init1(IN_CLOEXEC);
+  uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+  // The details printed with -l change with the attributes or contents of a file
+  if (pOptions->longOption) {
+    mask |= IN_ATTRIB | IN_MODIFY;
+  }
+
+  // The watch is added before the directory is read, so no change can be missed in between
+  if (inotifyFd == -1 || inotify_add_watch(inotifyFd, directoryPath, mask) == -1) {
+    Details_printError(out, "list: cannot watch directory '", directoryPath, "'\n", pOptions);
+    if (inotifyFd != -1) {
+      close(inotifyFd);
+    }
+    return;
+  }
+
+  WatchedDirectory directory = {0};
+  directory.path = directoryPath;
+  directory.directoryStream = Directory_open(AT_FDCWD, directoryPath);
+
+  if (directory.directoryStream == NULL) {
+    Details_printError(out, "list: cannot open directory '", directoryPath, "': Permission denied\n", pOptions);
+    close(inotifyFd);
+    return;
+  }
+
+  Output_initMemory(&directory.lineOutput);
+  bool isTerminal = isatty(STDOUT_FILENO);
+  loadWatchedDirectory(&directory, pOptions);
+  renderWatchedDirectory(out, &directory, isTerminal, pOptions);
+
+  union {
+    struct inotify_event event; // Aligns the buffer for the events read into it
+    char bytes[WATCH_BUFFER_LENGTH];
+  } buffer;
+  bool isRemoved = false;
+
+  while (!isRemoved) {
+    bool needsReload = false;
+    int readsCount = 0;
+    int pollStatus = 1;
+
+    // Wait for an event, then keep reading until no more arrive within the batch time
+    while (pollStatus > 0 && readsCount < WATCH_MAX_BATCH_READS) {
+      ssize_t length = read(inotifyFd, buffer.bytes, WATCH_BUFFER_LENGTH);
+
+      if (length == -1 && errno == EINTR) {
+        continue;
+      }
+
+      if (length <= 0) {
+        isRemoved = true;
+        break;
+      }
+
+      applyWatchEvents(&directory, buffer.bytes, length, pOptions, &needsReload, &isRemoved);
+      readsCount++;
+
+      struct pollfd pollDescriptor = {inotifyFd, POLLIN, 0};
+      pollStatus = poll(&pollDescriptor, 1, WATCH_BATCH_MILLISECONDS);
+    }
+
+    if (isRemoved) {
+      break;
+    }
+
+    if (needsReload) {
+      loadWatchedDirectory(&directory, pOptions);
+    }
+
+    renderWatchedDirectory(out, &directory, isTerminal, pOptions);
+  }
+
+  Details_printError(out, "list: directory '", directoryPath, "' is no longer available\n", pOptions);
+
+  clearWatchedEntries(&directory);
+  free(directory.entries);
+  free(directory.lines);
+  Output_free(&directory.lineOutput);
+  closedir(directory.directoryStream);
+  close(inotifyFd);
+  return;
+}
+#else
+// Watching directories requires inotify, which is only available on Linux
+void Watch_run(Output* out, char* directoryPath, Options* pOptions) {
+  Output_writeString(out, "list: --watch is not supported on this system\n");
+  return;
+}
+#endif
@@ -0,0 +1,13 @@
+// Handles keeping the listing of a directory up to date as it changes (--watch)
+#ifndef _WATCH_H_
+#define _WATCH_H_
+#include "options.h"
+#include "output.h"
+
+// Lists a directory, then keeps the listing up to date until the directory is removed
+// Changes are received from inotify, so only the files named by events are accessed again
+// Events that arrive close together are applied as a batch before the listing is printed again
+// Only supported on Linux, and prints an error on other systems
+void Watch_run(Output* out, char* directoryPath, Options* pOptions);
+
+#endif